@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Builds the machine-readable benchmark report from the raw counters written by
+run_benchmarks.sh and checks it against a stored baseline.
+
+Throughput (events/s, sim-seconds per wall-second) may not drop and peak RSS
+may not grow by more than the tolerance. Event counts and log sizes are
+deterministic for a given scenario, so any change there is reported as a
+behaviour change rather than a performance regression.
+"""
+
+import argparse
+import csv
+import json
+import os
+import sys
+
+
+def load_report(runs_path, logs_path):
+    runs = {}
+    with open(runs_path, newline='') as f:
+        for row in csv.DictReader(f):
+            key = f"{row['scenario']}/{row['numVehicles']}"
+            wall = float(row['wallSeconds'])
+            events = int(row['events'])
+            sim = float(row['simSeconds'])
+            runs[key] = {
+                'scenario': row['scenario'],
+                'numVehicles': int(row['numVehicles']),
+                'simTime': float(row['simTime']),
+                'events': events,
+                'wallSeconds': wall,
+                'eventsPerSecond': events / wall if wall > 0 else 0.0,
+                'simSecondsPerWallSecond': sim / wall if wall > 0 else 0.0,
+                'peakRssKb': int(row['peakRssKb']),
+                'logBytes': {},
+            }
+
+    with open(logs_path, newline='') as f:
+        for row in csv.DictReader(f):
+            key = f"{row['scenario']}/{row['numVehicles']}"
+            if key in runs:
+                runs[key]['logBytes'][row['log']] = int(row['bytes'])
+
+    for run in runs.values():
+        run['totalLogBytes'] = sum(run['logBytes'].values())
+
+    return {'runs': runs}
+
+
+def compare(report, baseline, tolerance):
+    regressions = []
+    changes = []
+
+    for key, run in sorted(report['runs'].items()):
+        base = baseline['runs'].get(key)
+        if base is None:
+            continue
+
+        for metric in ('eventsPerSecond', 'simSecondsPerWallSecond'):
+            if base[metric] > 0 and run[metric] < base[metric] * (1.0 - tolerance):
+                regressions.append(f"{key}: {metric} {base[metric]:.1f} -> {run[metric]:.1f}")
+
+        if base['peakRssKb'] > 0 and run['peakRssKb'] > base['peakRssKb'] * (1.0 + tolerance):
+            regressions.append(f"{key}: peakRssKb {base['peakRssKb']} -> {run['peakRssKb']}")
+
+        if run['events'] != base['events']:
+            changes.append(f"{key}: events {base['events']} -> {run['events']}")
+        if run['totalLogBytes'] != base['totalLogBytes']:
+            changes.append(f"{key}: totalLogBytes {base['totalLogBytes']} -> {run['totalLogBytes']}")
+
+    return regressions, changes
+
+
+def print_scaling(report):
+    print(f"{'scenario':<45} {'vehicles':>8} {'wall[s]':>10} {'events/s':>12} {'sim/wall':>10} {'rss[MB]':>9} {'logs[MB]':>9}")
+    for run in sorted(report['runs'].values(), key=lambda r: (r['scenario'], r['numVehicles'])):
+        print(f"{run['scenario']:<45} {run['numVehicles']:>8} {run['wallSeconds']:>10.2f} "
+              f"{run['eventsPerSecond']:>12.0f} {run['simSecondsPerWallSecond']:>10.3f} "
+              f"{run['peakRssKb'] / 1024.0:>9.1f} {run['totalLogBytes'] / 1048576.0:>9.1f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--runs', required=True, help='runs.csv written by run_benchmarks.sh')
+    parser.add_argument('--logs', required=True, help='logs.csv written by run_benchmarks.sh')
+    parser.add_argument('--out', required=True, help='Path of the JSON report')
+    parser.add_argument('--baseline', required=True, help='Stored baseline report')
+    parser.add_argument('--tolerance', type=float, default=0.15, help='Allowed relative regression')
+    parser.add_argument('--update-baseline', action='store_true', help='Store this report as the baseline')
+    args = parser.parse_args()
+
+    report = load_report(args.runs, args.logs)
+    with open(args.out, 'w') as f:
+        json.dump(report, f, indent=2, sort_keys=True)
+    print(f"Report written to {args.out}")
+    print_scaling(report)
+
+    if args.update_baseline:
+        with open(args.baseline, 'w') as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+        print(f"Baseline updated: {args.baseline}")
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print(f"No baseline at {args.baseline}; rerun with --update-baseline to store one.")
+        return 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    regressions, changes = compare(report, baseline, args.tolerance)
+    for change in changes:
+        print(f"Behaviour change: {change}")
+    for regression in regressions:
+        print(f"REGRESSION: {regression}")
+
+    if regressions:
+        return 1
+    print("No performance regressions against baseline.")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -26,6 +26,9 @@
 #include <fstream>
 #include <map>
 #include <vector>
+#include <chrono>
+#include <iostream>
+#include <sys/resource.h>
 
 using namespace ns3;
 
@@ -47,6 +50,7 @@ static std::ofstream jammer_output;
 static uint32_t g_numVehicles = 150;   // High density for congestion
 static double g_simTime = 60.0;
 static double g_bsmInterval = 0.1;     // 10 Hz
+static bool g_benchmark = false;      // Print performance counters at exit
 static uint32_t g_congestedAreaSize = 40; // Size of high density area
 static uint32_t g_freeflowAreaSize = 100; // Size of low density area
 static double g_speedLimit = 8.9;       // ~20 mph in m/s in congested areas
@@ -250,6 +254,25 @@ void InstallMixedCongestionMobility(NodeContainer nodes)
   mobility.Install(nodes);
 }
 
+// -------------------------
+// Benchmark Counters
+// -------------------------
+// Printed as a single line so run_benchmarks.sh can parse it.
+void PrintBenchmarkSummary(std::chrono::steady_clock::time_point wallStart)
+{
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::cout << "BENCHMARK"
+            << " events=" << Simulator::GetEventCount()
+            << " wallSeconds=" << wall
+            << " simSeconds=" << Simulator::Now().GetSeconds()
+            << " peakRssKb=" << usage.ru_maxrss
+            << std::endl;
+}
+
 // =====================================================
 // MAIN
 // =====================================================
@@ -258,6 +281,7 @@ int main(int argc, char *argv[])
   CommandLine cmd;
   cmd.AddValue("numVehicles", "Number of vehicles", g_numVehicles);
   cmd.AddValue("simTime", "Simulation time (s)", g_simTime);
+  cmd.AddValue("benchmark", "Print simulator performance counters at exit", g_benchmark);
   cmd.Parse(argc, argv);
 
   // Output files
@@ -338,7 +362,11 @@ int main(int argc, char *argv[])
   }
 
   Simulator::Stop(Seconds(g_simTime));
+  auto wallStart = std::chrono::steady_clock::now();
   Simulator::Run();
+  if (g_benchmark) {
+    PrintBenchmarkSummary(wallStart);
+  }
   Simulator::Destroy();
 
   return 0;
@@ -26,6 +26,9 @@
 #include <fstream>
 #include <map>
 #include <vector>
+#include <chrono>
+#include <iostream>
+#include <sys/resource.h>
 
 using namespace ns3;
 
@@ -47,6 +50,7 @@ static std::ofstream jammer_output;
 static uint32_t g_numVehicles = 50;
 static double g_simTime = 60.0;
 static double g_bsmInterval = 0.1;     // 10 Hz
+static bool g_benchmark = false;      // Print performance counters at exit
 static double g_laneSpacing = 4.0;     // Highway lane width
 static uint32_t g_lanes = 3;           // Number of lanes on each direction
 
@@ -243,6 +247,25 @@ void InstallHighwayMobility(NodeContainer nodes)
   }
 }
 
+// -------------------------
+// Benchmark Counters
+// -------------------------
+// Printed as a single line so run_benchmarks.sh can parse it.
+void PrintBenchmarkSummary(std::chrono::steady_clock::time_point wallStart)
+{
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::cout << "BENCHMARK"
+            << " events=" << Simulator::GetEventCount()
+            << " wallSeconds=" << wall
+            << " simSeconds=" << Simulator::Now().GetSeconds()
+            << " peakRssKb=" << usage.ru_maxrss
+            << std::endl;
+}
+
 // =====================================================
 // MAIN
 // =====================================================
@@ -251,6 +274,7 @@ int main(int argc, char *argv[])
   CommandLine cmd;
   cmd.AddValue("numVehicles", "Number of vehicles", g_numVehicles);
   cmd.AddValue("simTime", "Simulation time (s)", g_simTime);
+  cmd.AddValue("benchmark", "Print simulator performance counters at exit", g_benchmark);
   cmd.Parse(argc, argv);
 
   // Output files
@@ -331,7 +355,11 @@ int main(int argc, char *argv[])
   }
 
   Simulator::Stop(Seconds(g_simTime));
+  auto wallStart = std::chrono::steady_clock::now();
   Simulator::Run();
+  if (g_benchmark) {
+    PrintBenchmarkSummary(wallStart);
+  }
   Simulator::Destroy();
 
   return 0;
@@ -26,6 +26,9 @@
 #include <fstream>
 #include <map>
 #include <vector>
+#include <chrono>
+#include <iostream>
+#include <sys/resource.h>
 
 using namespace ns3;
 
@@ -47,6 +50,7 @@ static std::ofstream jammer_output;
 static uint32_t g_numVehicles = 100;   // Higher vehicle density
 static double g_simTime = 60.0;
 static double g_bsmInterval = 0.1;     // 10 Hz
+static bool g_benchmark = false;      // Print performance counters at exit
 static uint32_t g_gridSize = 10;       // 10x10 grid of intersections
 static double g_blockSize = 100.0;     // 100m between intersections
 static double g_maxSpeed = 13.4;       // ~30 mph (50 km/h) in m/s
@@ -236,6 +240,25 @@ void InstallUrbanGridMobility(NodeContainer nodes)
   mobility.Install(nodes);
 }
 
+// -------------------------
+// Benchmark Counters
+// -------------------------
+// Printed as a single line so run_benchmarks.sh can parse it.
+void PrintBenchmarkSummary(std::chrono::steady_clock::time_point wallStart)
+{
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::cout << "BENCHMARK"
+            << " events=" << Simulator::GetEventCount()
+            << " wallSeconds=" << wall
+            << " simSeconds=" << Simulator::Now().GetSeconds()
+            << " peakRssKb=" << usage.ru_maxrss
+            << std::endl;
+}
+
 // =====================================================
 // MAIN
 // =====================================================
@@ -244,6 +267,7 @@ int main(int argc, char *argv[])
   CommandLine cmd;
   cmd.AddValue("numVehicles", "Number of vehicles", g_numVehicles);
   cmd.AddValue("simTime", "Simulation time (s)", g_simTime);
+  cmd.AddValue("benchmark", "Print simulator performance counters at exit", g_benchmark);
   cmd.Parse(argc, argv);
 
   // Output files
@@ -324,7 +348,11 @@ int main(int argc, char *argv[])
   }
 
   Simulator::Stop(Seconds(g_simTime));
+  auto wallStart = std::chrono::steady_clock::now();
   Simulator::Run();
+  if (g_benchmark) {
+    PrintBenchmarkSummary(wallStart);
+  }
   Simulator::Destroy();
 
   return 0;
@@ -0,0 +1,103 @@
+#!/bin/bash
+
+# Macro-benchmark of the simulator itself: runs every scenario at geometric
+# fleet sizes for a short, fixed simulated time and records wall time,
+# events/s, peak RSS, bytes written per log and sim-seconds per wall-second.
+# The results are compared against a stored baseline to catch slowdowns.
+#
+# Usage (from the ns3 root directory):
+#   ./run_benchmarks.sh                    # run and check against baseline
+#   ./run_benchmarks.sh --update-baseline  # run and store as new baseline
+
+set -e  # Exit on any error
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+
+# Configuration (override through the environment)
+BENCH_SIM_TIME=${BENCH_SIM_TIME:-10.0}
+FLEET_SIZES=${FLEET_SIZES:-"50 100 200 500 1000 2000 5000"}
+SCENARIOS=${SCENARIOS:-"hisol-vanets-highway-low-density hisol-vanets-urban-grid-high-density hisol-vanets-congestion-mixed-scenario"}
+BASELINE=${BASELINE:-"$SCRIPT_DIR/benchmark_baseline.json"}
+TOLERANCE=${TOLERANCE:-0.15}  # Allowed relative slowdown before failing
+
+UPDATE_BASELINE=""
+if [ "$1" == "--update-baseline" ]; then
+    UPDATE_BASELINE="--update-baseline"
+fi
+
+# Ensure we're in the ns3 root directory
+if [ ! -f "ns3" ]; then
+    echo "Error: Cannot find the ns3 executable. Please run this script from the ns3 root directory."
+    exit 1
+fi
+
+OUT_DIR="benchmark/$(date +%Y%m%d-%H%M%S)"
+mkdir -p "$OUT_DIR"
+
+RUNS_CSV="$OUT_DIR/runs.csv"
+LOGS_CSV="$OUT_DIR/logs.csv"
+echo "scenario,numVehicles,simTime,events,wallSeconds,simSeconds,peakRssKb" > "$RUNS_CSV"
+echo "scenario,numVehicles,log,bytes" > "$LOGS_CSV"
+
+# Build once so compilation time never ends up in the measurements
+./ns3 build
+
+# Function to run one benchmark point and record its counters
+run_benchmark() {
+    local sim_name=$1
+    local vehicles=$2
+
+    echo "Benchmark: $sim_name with numVehicles=$vehicles, simTime=$BENCH_SIM_TIME"
+
+    local run_dir="$OUT_DIR/$sim_name/vehicles-$vehicles"
+    mkdir -p "$run_dir"
+
+    # Start from a clean set of logs so the byte counts belong to this run
+    rm -f ./*_log.csv
+
+    ./ns3 run --no-build "$sim_name" -- --simTime="$BENCH_SIM_TIME" --numVehicles="$vehicles" \
+        --benchmark=true > "$run_dir/stdout.txt" 2>&1
+
+    local summary
+    summary=$(grep "^BENCHMARK" "$run_dir/stdout.txt" | tail -n 1)
+    if [ -z "$summary" ]; then
+        echo "  -> Error: no BENCHMARK line in output, see $run_dir/stdout.txt"
+        exit 1
+    fi
+
+    local events wall sim rss
+    events=$(echo "$summary" | sed -n 's/.*events=\([^ ]*\).*/\1/p')
+    wall=$(echo "$summary" | sed -n 's/.*wallSeconds=\([^ ]*\).*/\1/p')
+    sim=$(echo "$summary" | sed -n 's/.*simSeconds=\([^ ]*\).*/\1/p')
+    rss=$(echo "$summary" | sed -n 's/.*peakRssKb=\([^ ]*\).*/\1/p')
+    echo "$sim_name,$vehicles,$BENCH_SIM_TIME,$events,$wall,$sim,$rss" >> "$RUNS_CSV"
+    echo "  -> events=$events wall=${wall}s peakRss=${rss}kB"
+
+    # Record the size of every log and keep the logs next to the counters
+    for file in ./*_log.csv; do
+        if [ -f "$file" ]; then
+            local name
+            name=$(basename "$file")
+            echo "$sim_name,$vehicles,$name,$(stat -c %s "$file")" >> "$LOGS_CSV"
+            mv "$file" "$run_dir/"
+        fi
+    done
+}
+
+echo "Starting benchmarks..."
+
+for sim_name in $SCENARIOS; do
+    for vehicles in $FLEET_SIZES; do
+        run_benchmark "$sim_name" "$vehicles"
+    done
+done
+
+echo ""
+echo "Building report..."
+python3 "$SCRIPT_DIR/benchmark_report.py" \
+    --runs "$RUNS_CSV" \
+    --logs "$LOGS_CSV" \
+    --out "$OUT_DIR/report.json" \
+    --baseline "$BASELINE" \
+    --tolerance "$TOLERANCE" \
+    $UPDATE_BASELINE
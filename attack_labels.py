@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""
+Ground-truth labels from the attack_log.csv written by vanets-new.cc.
+
+Each row is one attack interval: id,attackerId,attackType,start,end where id
+is the misbehaving identity (an attacker or one of its fake Sybil IDs).
+AttackLabels.lookup(id, t) is a binary search over that identity's
+intervals, so labelling a log is one lookup per record instead of a merge:
+
+    labels = AttackLabels.load('attack_log.csv')
+    trust['attackType'] = [labels.lookup(n, t) for n, t in zip(trust.nodeId, trust.timestamp)]
+"""
+
+import bisect
+import csv
+import sys
+
+
+class AttackLabels:
+    def __init__(self):
+        self._starts = {}
+        self._intervals = {}
+
+    @classmethod
+    def load(cls, path):
+        labels = cls()
+        rows = {}
+        with open(path, newline='') as f:
+            for row in csv.DictReader(f):
+                rows.setdefault(int(row['id']), []).append(
+                    (float(row['start']), float(row['end']), int(row['attackerId']), row['attackType']))
+        for ident, intervals in rows.items():
+            intervals.sort()
+            labels._starts[ident] = [iv[0] for iv in intervals]
+            labels._intervals[ident] = intervals
+        return labels
+
+    def lookup(self, ident, t):
+        """Attack type of identity `ident` at time `t`, or 'none'."""
+        starts = self._starts.get(int(ident))
+        if not starts:
+            return 'none'
+        i = bisect.bisect_right(starts, float(t)) - 1
+        if i < 0:
+            return 'none'
+        start, end, _, attack_type = self._intervals[int(ident)][i]
+        return attack_type if t <= end else 'none'
+
+    def attacker(self, ident, t):
+        """Physical attacker behind identity `ident` at time `t`, or None."""
+        starts = self._starts.get(int(ident))
+        if not starts:
+            return None
+        i = bisect.bisect_right(starts, float(t)) - 1
+        if i < 0 or t > self._intervals[int(ident)][i][1]:
+            return None
+        return self._intervals[int(ident)][i][2]
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print(f"Usage: {sys.argv[0]} attack_log.csv")
+        sys.exit(1)
+    labels = AttackLabels.load(sys.argv[1])
+    for ident, intervals in sorted(labels._intervals.items()):
+        for start, end, attacker, attack_type in intervals:
+            print(f"{ident:>8} {attack_type:<14} attacker={attacker:<5} [{start:.3f}, {end:.3f}]")
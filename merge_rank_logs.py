@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""
+Merges the per-rank logs written by vanets-new.cc in distributed mode
+(e.g. trust_log-rank0.csv, trust_log-rank1.csv, ...) back into the single
+files a sequential run produces (trust_log.csv, ...).
+
+Rows are ordered by (timestamp, nodeId) when the log has those columns, which
+is the order the sequential detector sweeps emit them in. ROC tables
+(roc_log-rankN.csv) hold counts, which are summed per (detector, threshold).
+"""
+
+import argparse
+import csv
+import glob
+import os
+import re
+import sys
+
+RANK_FILE = re.compile(r'^(?P<base>.+)-rank(?P<rank>\d+)\.csv$')
+
+
+def sort_key(header):
+    ts = header.index('timestamp') if 'timestamp' in header else None
+    node = header.index('nodeId') if 'nodeId' in header else None
+
+    def key(row):
+        try:
+            t = float(row[ts]) if ts is not None else 0.0
+        except (ValueError, IndexError):
+            t = 0.0
+        try:
+            n = int(row[node]) if node is not None else 0
+        except (ValueError, IndexError):
+            n = 0
+        return (t, n)
+
+    return key if ts is not None else None
+
+
+def sum_roc_rows(header, rows):
+    counts = {}
+    order = []
+    for row in rows:
+        key = (row[header.index('detector')], row[header.index('threshold')])
+        if key not in counts:
+            counts[key] = [0, 0, 0, 0]
+            order.append(key)
+        for i, col in enumerate(('tp', 'fp', 'tn', 'fn')):
+            counts[key][i] += int(row[header.index(col)])
+
+    merged = []
+    for key in order:
+        tp, fp, tn, fn = counts[key]
+        tpr = tp / (tp + fn) if tp + fn else 0.0
+        fpr = fp / (fp + tn) if fp + tn else 0.0
+        precision = tp / (tp + fp) if tp + fp else 1.0
+        merged.append([key[0], key[1], tp, fp, tn, fn, tpr, fpr, precision])
+    return merged
+
+
+def merge(base, files, out_dir, keep):
+    files = sorted(files, key=lambda p: int(RANK_FILE.match(os.path.basename(p)).group('rank')))
+    header = None
+    rows = []
+    for path in files:
+        with open(path, newline='') as f:
+            reader = csv.reader(f)
+            file_header = next(reader, None)
+            if file_header is None:
+                continue
+            if header is None:
+                header = file_header
+            rows.extend(reader)
+
+    if header is None:
+        return 0
+
+    key = sort_key(header)
+    if 'threshold' in header and 'tp' in header:
+        rows = sum_roc_rows(header, rows)
+    elif key is not None:
+        rows.sort(key=key)  # stable: ties keep rank order
+
+    out_path = os.path.join(out_dir, base + '.csv')
+    with open(out_path, 'w', newline='') as f:
+        writer = csv.writer(f, lineterminator='\n')
+        writer.writerow(header)
+        writer.writerows(rows)
+
+    if not keep:
+        for path in files:
+            os.remove(path)
+    return len(rows)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('directory', nargs='?', default='.', help='Directory holding the *-rankN.csv logs')
+    parser.add_argument('--keep', action='store_true', help='Keep the per-rank files')
+    args = parser.parse_args()
+
+    groups = {}
+    for path in glob.glob(os.path.join(args.directory, '*-rank*.csv')):
+        m = RANK_FILE.match(os.path.basename(path))
+        if m:
+            groups.setdefault(m.group('base'), []).append(path)
+
+    if not groups:
+        print(f"No per-rank logs found in {args.directory}")
+        return 1
+
+    for base, files in sorted(groups.items()):
+        n = merge(base, files, args.directory, args.keep)
+        print(f"{base}.csv: {n} rows from {len(files)} ranks")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
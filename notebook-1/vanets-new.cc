@@ -5,6 +5,7 @@
  *  - Mitigation techniques: Trust-based, ML-based, Hybrid, Rule-based
  *  - Detailed logging for analysis
  *  - ML Features as specified in data.txt
+ *  - Detectors run at each receiver on what that vehicle actually heard
  *
  * Works on NS-3.46 out of the box.
  */
@@ -25,8 +26,9 @@
 #include <algorithm>
 #include <set>
 #include <cmath>
-#include <queue>
 #include <limits>
+#include <unordered_map>
+#include <cstdio>
 
 using namespace ns3;
 
@@ -75,14 +77,6 @@ std::set<uint32_t> sybilNodes;
 std::set<uint32_t> jammerNodes;
 std::set<uint32_t> falsifiedNodes;
 
-// Trust system
-std::map<uint32_t, double> nodeTrust; // Trust scores for each node
-std::map<uint32_t, std::vector<double>> trustHistory; // Track trust over time
-
-// ML-based detection
-std::map<uint32_t, std::vector<double>> mobilityHistory; // Store position history
-std::map<uint32_t, int> suspiciousCount; // Suspicious behavior count
-
 // Rule-based detection
 std::map<uint32_t, int> packetFreqCount; // Track packet frequency per node
 std::map<uint32_t, std::vector<Time>> packetTimestamps; // Track timestamps
@@ -95,22 +89,334 @@ struct BeaconFeatures {
   uint32_t neighborCount;   // neighbor_count (last window)
   double distanceToNearestNeighbor; // distance_to_nearest_neighbor
   double interArrivalTime;  // inter_arrival_time for messages from same src
+  double interArrivalStd;   // spread of inter_arrival_time
   double packetRate;        // packet_rate (pkts/s)
   double avgPayloadSize;    // average payload size
+  double payloadSizeStd;    // spread of payload size
   double positionDelta;     // position_delta (claimed vs. expected path)
   double speedDelta;        // speed_delta between GPS and inertial estimate
   int clusterSize;          // clustering of identities (for Sybil detection)
 
   BeaconFeatures() : position(0,0,0), velocity(0,0,0), neighborCount(0),
                      distanceToNearestNeighbor(0), interArrivalTime(0),
-                     packetRate(0), avgPayloadSize(0), positionDelta(0),
-                     speedDelta(0), clusterSize(0) {}
+                     interArrivalStd(0), packetRate(0), avgPayloadSize(0),
+                     payloadSizeStd(0), positionDelta(0), speedDelta(0),
+                     clusterSize(0) {}
+};
+
+// -------------------------
+// Streaming Feature Engine
+// -------------------------
+static double g_featureInterval = 0.5;  // Cadence of features_log rows (s)
+static double g_featureRateTau = 1.0;   // Time constant of the packet-rate EWMA (s)
+static double g_clusterRadius = 50.0;   // Identities claiming positions this close form a cluster (m)
+static double g_clusterWindow = 1.0;    // Identities silent for longer leave their cluster (s)
+
+// Fixed-size running statistics per sender identity, updated in O(1) per
+// beacon. All receivers of a frame see the same packet UID, so only the first
+// copy updates the sender; DDoS bursts are distinct frames and still count.
+struct SenderFeatureState {
+  bool seen = false;
+  uint64_t lastUid = 0;
+  double lastRx = 0;         // reception time of the previous beacon
+  double rate = 0;           // EWMA packet rate at lastRx
+  uint64_t intervals = 0;    // Welford inter-arrival mean/M2
+  double iatMean = 0;
+  double iatM2 = 0;
+  uint64_t payloads = 0;     // Welford payload size mean/M2
+  double payloadMean = 0;
+  double payloadM2 = 0;
+  Vector lastPos;            // previous claim, for dead reckoning
+  Vector lastVel;
+  double lastClaimTime = 0;
+  int64_t cell = 0;          // cell in claimGrid
+  bool pending = false;      // heard since the last emitted row
+  BeaconFeatures features;
+};
+
+std::unordered_map<uint32_t, SenderFeatureState> senderFeatures;
+std::unordered_map<int64_t, std::vector<uint32_t>> claimGrid; // identities by claimed-position cell
+
+int64_t ClaimCell(double x, double y)
+{
+  int64_t cx = (int64_t)std::floor(x / g_clusterRadius);
+  int64_t cy = (int64_t)std::floor(y / g_clusterRadius);
+  return (cx << 32) ^ (cy & 0xffffffff);
+}
+
+// Identities (including this one) whose latest claim lies within
+// g_clusterRadius; only the 3x3 cells around the claim are visited.
+int CountCluster(const Vector& pos, double now)
+{
+  int64_t cx = (int64_t)std::floor(pos.x / g_clusterRadius);
+  int64_t cy = (int64_t)std::floor(pos.y / g_clusterRadius);
+  int count = 0;
+  for (int64_t dx = -1; dx <= 1; dx++) {
+    for (int64_t dy = -1; dy <= 1; dy++) {
+      auto it = claimGrid.find(((cx + dx) << 32) ^ ((cy + dy) & 0xffffffff));
+      if (it == claimGrid.end()) continue;
+      for (uint32_t id : it->second) {
+        const SenderFeatureState& other = senderFeatures[id];
+        if (now - other.lastRx > g_clusterWindow) continue;
+        double ddx = other.lastPos.x - pos.x;
+        double ddy = other.lastPos.y - pos.y;
+        if (ddx*ddx + ddy*ddy <= g_clusterRadius*g_clusterRadius) count++;
+      }
+    }
+  }
+  return count;
+}
+
+void ObserveBeacon(uint32_t senderId, uint64_t uid, Vector pos, Vector vel,
+                   double claimTime, uint32_t payloadSize)
+{
+  SenderFeatureState& st = senderFeatures[senderId];
+  if (st.seen && uid <= st.lastUid) return; // another receiver's copy
+
+  double now = Simulator::Now().GetSeconds();
+  BeaconFeatures& f = st.features;
+
+  if (st.seen) {
+    double iat = now - st.lastRx;
+    st.intervals++;
+    double d = iat - st.iatMean;
+    st.iatMean += d / st.intervals;
+    st.iatM2 += d * (iat - st.iatMean);
+    st.rate = st.rate * std::exp(-iat / g_featureRateTau) + 1.0 / g_featureRateTau;
+
+    // Deviation from where the previous claim says the sender should be now
+    double dt = claimTime - st.lastClaimTime;
+    double px = st.lastPos.x + st.lastVel.x * dt;
+    double py = st.lastPos.y + st.lastVel.y * dt;
+    f.positionDelta = std::hypot(pos.x - px, pos.y - py);
+
+    // Claimed speed against the speed implied by the claimed displacement
+    if (dt > 0) {
+      double moved = std::hypot(pos.x - st.lastPos.x, pos.y - st.lastPos.y);
+      f.speedDelta = std::fabs(std::hypot(vel.x, vel.y) - moved / dt);
+    } else {
+      f.speedDelta = 0;
+    }
+  } else {
+    st.rate = 1.0 / g_featureRateTau;
+  }
+
+  st.payloads++;
+  double d = payloadSize - st.payloadMean;
+  st.payloadMean += d / st.payloads;
+  st.payloadM2 += d * (payloadSize - st.payloadMean);
+
+  // Move the identity to the cell of its new claim
+  int64_t cell = ClaimCell(pos.x, pos.y);
+  if (!st.seen || cell != st.cell) {
+    if (st.seen) {
+      std::vector<uint32_t>& old = claimGrid[st.cell];
+      auto it = std::find(old.begin(), old.end(), senderId);
+      if (it != old.end()) {
+        *it = old.back();
+        old.pop_back();
+      }
+    }
+    claimGrid[cell].push_back(senderId);
+    st.cell = cell;
+  }
+
+  st.seen = true;
+  st.lastUid = uid;
+  st.lastRx = now;
+  st.lastPos = pos;
+  st.lastVel = vel;
+  st.lastClaimTime = claimTime;
+  st.pending = true;
+
+  f.position = pos;
+  f.velocity = vel;
+  f.timestamp = Seconds(claimTime);
+  f.interArrivalTime = st.iatMean;
+  f.interArrivalStd = st.intervals > 1 ? std::sqrt(st.iatM2 / (st.intervals - 1)) : 0;
+  f.avgPayloadSize = st.payloadMean;
+  f.payloadSizeStd = st.payloads > 1 ? std::sqrt(st.payloadM2 / (st.payloads - 1)) : 0;
+  f.clusterSize = CountCluster(pos, now);
+}
+
+void UpdateNeighborFeatures(uint32_t nodeId, uint32_t count, double minDistance)
+{
+  auto it = senderFeatures.find(nodeId);
+  if (it == senderFeatures.end()) return;
+  it->second.features.neighborCount = count;
+  it->second.features.distanceToNearestNeighbor = minDistance;
+}
+
+// One row per identity heard since the previous row, every g_featureInterval
+void EmitFeatures()
+{
+  double now = Simulator::Now().GetSeconds();
+
+  std::vector<uint32_t> ids;
+  for (auto& entry : senderFeatures) {
+    if (entry.second.pending) ids.push_back(entry.first);
+  }
+  std::sort(ids.begin(), ids.end());
+
+  for (uint32_t id : ids) {
+    SenderFeatureState& st = senderFeatures[id];
+    BeaconFeatures& f = st.features;
+    f.packetRate = st.rate * std::exp(-(now - st.lastRx) / g_featureRateTau);
+    double speed = std::hypot(f.velocity.x, f.velocity.y);
+    double heading = std::atan2(f.velocity.y, f.velocity.x);
+
+    features_output << id << ","
+                  << f.position.x << "," << f.position.y << ","
+                  << speed << "," << heading << ","
+                  << now << ","
+                  << f.interArrivalTime << ","
+                  << f.avgPayloadSize << ","
+                  << f.interArrivalStd << ","
+                  << f.payloadSizeStd << ","
+                  << f.packetRate << ","
+                  << f.positionDelta << ","
+                  << f.speedDelta << ","
+                  << f.neighborCount << ","
+                  << f.distanceToNearestNeighbor << ","
+                  << f.clusterSize << "\n";
+    st.pending = false;
+  }
+
+  Simulator::Schedule(Seconds(g_featureInterval), &EmitFeatures);
+}
+
+// -------------------------
+// Receiver-side Neighbor Tables
+// -------------------------
+// Each vehicle only knows the BSMs it has heard. Its neighbor table is a
+// fixed-capacity open-addressing table (linear probing) keyed by claimed ID.
+// Probes are capped at g_neighborProbe slots; when none of them is free the
+// least recently heard entry in that window is evicted, so a flood of Sybil
+// identities cannot grow the table or slow down lookups.
+static uint32_t g_neighborCapacity = 64; // Slots per vehicle (rounded up to a power of two)
+static double g_neighborTimeout = 2.0;   // Neighbors silent for longer are dropped (s)
+static const uint32_t g_neighborProbe = 8;
+
+struct NeighborEntry {
+  uint32_t id = 0;           // claimed sender ID
+  bool used = false;
+  Vector pos;                // last claimed kinematics
+  Vector vel;
+  double claimTime = 0;
+  double lastRx = 0;         // when this vehicle last heard it
+  uint32_t heard = 0;        // beacons heard from it
+  // Detector state as seen by this observer
+  double trust = 1.0;
+  uint32_t trustSamples = 0;
+  int suspicious = 0;
+  uint32_t mlSamples = 0;
+};
+
+class NeighborTable
+{
+public:
+  void Init(uint32_t capacity)
+  {
+    m_bits = 1;
+    while ((1u << m_bits) < capacity) m_bits++;
+    m_slots.assign(1u << m_bits, NeighborEntry());
+    m_size = 0;
+    m_evictions = 0;
+  }
+
+  NeighborEntry* Find(uint32_t id)
+  {
+    uint32_t mask = m_slots.size() - 1;
+    uint32_t i = Home(id);
+    for (uint32_t k = 0; k < Probes(); k++, i = (i + 1) & mask) {
+      if (!m_slots[i].used) return nullptr;
+      if (m_slots[i].id == id) return &m_slots[i];
+    }
+    return nullptr;
+  }
+
+  // Entry for `id`, inserted (evicting if needed) when not present
+  NeighborEntry& Touch(uint32_t id)
+  {
+    uint32_t mask = m_slots.size() - 1;
+    uint32_t i = Home(id);
+    uint32_t victim = i;
+    for (uint32_t k = 0; k < Probes(); k++, i = (i + 1) & mask) {
+      NeighborEntry& e = m_slots[i];
+      if (e.used && e.id == id) return e;
+      if (!e.used) {
+        victim = i;
+        m_size++;
+        break;
+      }
+      if (e.lastRx < m_slots[victim].lastRx) victim = i;
+      if (k == Probes() - 1) m_evictions++;
+    }
+    NeighborEntry& e = m_slots[victim];
+    e = NeighborEntry();
+    e.id = id;
+    e.used = true;
+    return e;
+  }
+
+  // Drops neighbors not heard within `timeout`
+  void Expire(double now, double timeout)
+  {
+    for (uint32_t i = 0; i < m_slots.size(); i++) {
+      while (m_slots[i].used && now - m_slots[i].lastRx > timeout) {
+        Erase(i);
+      }
+    }
+  }
+
+  std::vector<NeighborEntry>& Slots() { return m_slots; }
+  uint32_t Size() const { return m_size; }
+  uint64_t Evictions() const { return m_evictions; }
+
+private:
+  uint32_t Home(uint32_t id) const { return (id * 2654435761u) >> (32 - m_bits); }
+  uint32_t Probes() const { return std::min<uint32_t>(g_neighborProbe, m_slots.size()); }
+
+  // Backward-shift deletion keeps every probe chain free of holes
+  void Erase(uint32_t i)
+  {
+    uint32_t mask = m_slots.size() - 1;
+    uint32_t j = i;
+    for (uint32_t k = 1; k < m_slots.size(); k++) {
+      j = (j + 1) & mask;
+      if (!m_slots[j].used) break;
+      uint32_t home = Home(m_slots[j].id);
+      if (((j - home) & mask) >= ((j - i) & mask)) {
+        m_slots[i] = m_slots[j];
+        i = j;
+      }
+    }
+    m_slots[i] = NeighborEntry();
+    m_size--;
+  }
+
+  uint32_t m_bits = 1;
+  std::vector<NeighborEntry> m_slots;
+  uint32_t m_size = 0;
+  uint64_t m_evictions = 0;
 };
 
-// Per-node feature tracking
-std::map<uint32_t, std::queue<BeaconFeatures>> nodeFeatures;
-std::map<uint32_t, std::vector<Time>> nodeMessageTimes; // for inter-arrival calculation
-std::map<uint32_t, std::vector<double>> nodePayloadSizes; // for average payload calculation
+std::vector<NeighborTable> neighborTables; // indexed by receiver node ID
+
+bool IsFresh(const NeighborEntry& e, double now)
+{
+  return e.used && now - e.lastRx <= g_neighborTimeout;
+}
+
+void ObserveNeighbor(uint32_t receiverId, uint32_t senderId, Vector pos, Vector vel, double claimTime)
+{
+  NeighborEntry& e = neighborTables[receiverId].Touch(senderId);
+  e.pos = pos;
+  e.vel = vel;
+  e.claimTime = claimTime;
+  e.lastRx = Simulator::Now().GetSeconds();
+  e.heard++;
+}
 
 // -------------------------------
 // Enhanced BSM Application with Attack Capabilities
@@ -147,47 +453,6 @@ private:
     Vector pos = mob->GetPosition();
     Vector vel = mob->GetVelocity();
 
-    // Calculate features for ML
-    BeaconFeatures features;
-    features.position = pos;
-    features.velocity = vel;
-    features.timestamp = Simulator::Now();
-
-    // Calculate speed
-    double speed = sqrt(vel.x*vel.x + vel.y*vel.y);
-
-    // Calculate heading (in radians)
-    double heading = atan2(vel.y, vel.x);
-
-    // Add to message times for inter_arrival calculation
-    nodeMessageTimes[m_node->GetId()].push_back(Simulator::Now());
-    if (nodeMessageTimes[m_node->GetId()].size() > 100) {
-      nodeMessageTimes[m_node->GetId()].erase(nodeMessageTimes[m_node->GetId()].begin());
-    }
-
-    // Calculate inter arrival time
-    if (nodeMessageTimes[m_node->GetId()].size() >= 2) {
-      Time lastTime = nodeMessageTimes[m_node->GetId()].back();
-      Time secondLastTime = *(nodeMessageTimes[m_node->GetId()].end() - 2);
-      features.interArrivalTime = (lastTime - secondLastTime).GetSeconds();
-    }
-
-    // Add to payload size history (assuming fixed size for now)
-    double payloadSize = 200.0; // Fixed size for this simulation
-    nodePayloadSizes[m_node->GetId()].push_back(payloadSize);
-    if (nodePayloadSizes[m_node->GetId()].size() > 50) {
-      nodePayloadSizes[m_node->GetId()].erase(nodePayloadSizes[m_node->GetId()].begin());
-    }
-
-    // Calculate average payload size
-    if (!nodePayloadSizes[m_node->GetId()].empty()) {
-      double sum = 0;
-      for (double size : nodePayloadSizes[m_node->GetId()]) {
-        sum += size;
-      }
-      features.avgPayloadSize = sum / nodePayloadSizes[m_node->GetId()].size();
-    }
-
     // Create BSM with additional fields for attack detection
     std::ostringstream msg;
     msg << "BSM," << m_node->GetId()
@@ -287,23 +552,6 @@ private:
             << "," << vel.x << "," << vel.y
             << "," << Simulator::Now().GetSeconds() << "\n";
 
-    // Store features for ML
-    nodeFeatures[m_node->GetId()].push(features);
-    if (nodeFeatures[m_node->GetId()].size() > 100) { // Keep last 100 features
-      nodeFeatures[m_node->GetId()].pop();
-    }
-
-    // Log features if we have enough data
-    if (nodeFeatures[m_node->GetId()].size() == 1) { // Log first feature
-      BeaconFeatures& f = nodeFeatures[m_node->GetId()].front();
-      features_output << m_node->GetId() << ","
-                    << f.position.x << "," << f.position.y << ","
-                    << speed << "," << heading << ","
-                    << f.timestamp.GetSeconds() << ","
-                    << f.interArrivalTime << ","
-                    << f.avgPayloadSize << "\n";
-    }
-
     // Schedule next transmission
     Simulator::Schedule(Seconds(m_interval), &EnhancedBsmApp::SendBsm, this);
   }
@@ -312,12 +560,13 @@ private:
 // -------------------------
 // Trust-based Mitigation System
 // -------------------------
-double calculateTrustScore(uint32_t nodeId, Vector pos, Vector vel, Time timestamp)
+double calculateTrustScore(NeighborEntry& neighbor)
 {
   double trust = 1.0; // Start with high trust
+  const Vector& vel = neighbor.vel;
 
   // Check if position is physically plausible
-  if (nodeId < g_numVehicles * 0.8) { // Only check for real vehicles, not sybil
+  if (neighbor.id < g_numVehicles * 0.8) { // Only check for real vehicles, not sybil
     if (vel.x > 50.0 || vel.y > 50.0) { // Unusually high speed
       trust -= 0.3;
     }
@@ -326,45 +575,37 @@ double calculateTrustScore(uint32_t nodeId, Vector pos, Vector vel, Time timesta
     }
   }
 
-  // Add to trust history
-  trustHistory[nodeId].push_back(trust);
-  if (trustHistory[nodeId].size() > 100) { // Only keep recent history
-    trustHistory[nodeId].erase(trustHistory[nodeId].begin());
-  }
-
-  // Calculate average trust over time
-  double avgTrust = trust;
-  if (!trustHistory[nodeId].empty()) {
-    double sum = 0;
-    for (double t : trustHistory[nodeId]) {
-      sum += t;
-    }
-    avgTrust = sum / trustHistory[nodeId].size();
+  // Average trust over time: a running mean for the first 100 samples,
+  // then an exponential average with the same memory
+  if (neighbor.trustSamples < 100) {
+    neighbor.trustSamples++;
   }
+  neighbor.trust += (trust - neighbor.trust) / neighbor.trustSamples;
 
-  return avgTrust;
+  return neighbor.trust;
 }
 
 // Update trust scores
 void UpdateTrustScores(NodeContainer nodes)
 {
+  double now = Simulator::Now().GetSeconds();
   for (uint32_t i = 0; i < nodes.GetN(); i++)
   {
-    Ptr<MobilityModel> mob = nodes.Get(i)->GetObject<MobilityModel>();
-    Vector pos = mob->GetPosition();
-    Vector vel = mob->GetVelocity();
-    
-    double trust = calculateTrustScore(i, pos, vel, Simulator::Now());
-    
-    // Update global trust score
-    nodeTrust[i] = trust;
-    
-    // Log trust score
-    trust_output << Simulator::Now().GetSeconds() 
-                << "," << i 
-                << "," << trust 
-                << "," << (trust < 0.5 ? 1 : 0)  // Flag if low trust
-                << "\n";
+    // Every vehicle rates the neighbors it has heard from
+    for (NeighborEntry& neighbor : neighborTables[i].Slots())
+    {
+      if (!IsFresh(neighbor, now)) continue;
+
+      double trust = calculateTrustScore(neighbor);
+
+      // Log trust score
+      trust_output << now
+                  << "," << neighbor.id
+                  << "," << trust
+                  << "," << (trust < 0.5 ? 1 : 0)  // Flag if low trust
+                  << "," << i
+                  << "\n";
+    }
   }
 
   Simulator::Schedule(Seconds(1.0), &UpdateTrustScores, nodes);
@@ -373,49 +614,51 @@ void UpdateTrustScores(NodeContainer nodes)
 // -------------------------
 // ML-based Detection (Simple Anomaly Detection)
 // -------------------------
-bool detectAnomaly(uint32_t nodeId, Vector pos, Vector vel)
+bool detectAnomaly(NeighborEntry& neighbor)
 {
   // Simple ML-based detection: check for anomalous behavior
   bool isAnomaly = false;
   
   // Check if velocity is outside normal bounds
+  const Vector& vel = neighbor.vel;
   double speed = sqrt(vel.x*vel.x + vel.y*vel.y);
   if (speed > 40.0) { // More than 40 m/s (~90 mph) is suspicious
     isAnomaly = true;
-    suspiciousCount[nodeId]++;
+    neighbor.suspicious++;
   }
   
   // Check if position changed too much since last reading
-  if (!mobilityHistory[nodeId].empty() && mobilityHistory[nodeId].size() >= 4) {
+  if (neighbor.mlSamples > 0) {
     // Compare current and previous positions
     // This is a simplified check
     if (speed > 35.0) { // High speed movement
       isAnomaly = true;
-      suspiciousCount[nodeId]++;
+      neighbor.suspicious++;
     }
   }
-  
-  // Store current position for future comparisons
-  mobilityHistory[nodeId] = {pos.x, pos.y, vel.x, vel.y};
+  neighbor.mlSamples++;
   
   return isAnomaly;
 }
 
 void RunMLDetection(NodeContainer nodes)
 {
+  double now = Simulator::Now().GetSeconds();
   for (uint32_t i = 0; i < nodes.GetN(); i++)
   {
-    Ptr<MobilityModel> mob = nodes.Get(i)->GetObject<MobilityModel>();
-    Vector pos = mob->GetPosition();
-    Vector vel = mob->GetVelocity();
-    
-    bool isAnomaly = detectAnomaly(i, pos, vel);
-    
-    if (isAnomaly) {
-      ml_output << Simulator::Now().GetSeconds() 
-               << "," << i 
-               << ",anomaly_detected," << suspiciousCount[i] 
-               << "\n";
+    for (NeighborEntry& neighbor : neighborTables[i].Slots())
+    {
+      if (!IsFresh(neighbor, now)) continue;
+
+      bool isAnomaly = detectAnomaly(neighbor);
+
+      if (isAnomaly) {
+        ml_output << now
+                 << "," << neighbor.id
+                 << ",anomaly_detected," << neighbor.suspicious
+                 << "," << i
+                 << "\n";
+      }
     }
   }
   
@@ -474,24 +717,28 @@ void UpdateRuleBasedDetection(NodeContainer nodes)
 // -------------------------
 void RunHybridDetection(NodeContainer nodes)
 {
+  double now = Simulator::Now().GetSeconds();
   for (uint32_t i = 0; i < nodes.GetN(); i++)
   {
-    Ptr<MobilityModel> mob = nodes.Get(i)->GetObject<MobilityModel>();
-    Vector pos = mob->GetPosition();
-    Vector vel = mob->GetVelocity();
-    
-    bool mlAnomaly = detectAnomaly(i, pos, vel);
-    bool ruleSuspicious = checkRuleBased(i);
-    double trustScore = nodeTrust[i];
-    
-    // Hybrid detection: flag if any method detects an issue AND trust is low
-    if ((mlAnomaly || ruleSuspicious) && trustScore < 0.6) {
-      mitigation_output << Simulator::Now().GetSeconds()
-                      << "," << i
-                      << ",hybrid_detection,ml_anomaly=" << mlAnomaly 
-                      << ",rule_violation=" << ruleSuspicious
-                      << ",trust_score=" << trustScore
-                      << "\n";
+    for (NeighborEntry& neighbor : neighborTables[i].Slots())
+    {
+      if (!IsFresh(neighbor, now)) continue;
+
+      bool mlAnomaly = detectAnomaly(neighbor);
+      bool ruleSuspicious = checkRuleBased(neighbor.id);
+      // A neighbor the trust system has not rated yet counts as untrusted
+      double trustScore = neighbor.trustSamples > 0 ? neighbor.trust : 0.0;
+
+      // Hybrid detection: flag if any method detects an issue AND trust is low
+      if ((mlAnomaly || ruleSuspicious) && trustScore < 0.6) {
+        mitigation_output << now
+                        << "," << neighbor.id
+                        << ",hybrid_detection,ml_anomaly=" << mlAnomaly
+                        << ",rule_violation=" << ruleSuspicious
+                        << ",trust_score=" << trustScore
+                        << ",observer=" << i
+                        << "\n";
+      }
     }
   }
   
@@ -526,6 +773,14 @@ void ReceivePacket(Ptr<Socket> socket)
       packetFreqCount[nodeId]++;
     }
 
+    // Feed the sender's streaming features
+    uint32_t senderId;
+    double x, y, vx, vy, t;
+    if (std::sscanf(s.c_str(), "BSM,%u,%lf,%lf,%lf,%lf,%lf", &senderId, &x, &y, &vx, &vy, &t) == 6) {
+      ObserveNeighbor(node->GetId(), senderId, Vector(x, y, 0), Vector(vx, vy, 0), t);
+      ObserveBeacon(senderId, packet->GetUid(), Vector(x, y, 0), Vector(vx, vy, 0), t, packet->GetSize());
+    }
+
     // Log RSSI information (placeholder)
     double rssi = -1.0; // Placeholder - actual RSSI requires detailed channel model
     rssi_output << node->GetId() << "," << s << "," << rssi << "\n";
@@ -533,27 +788,27 @@ void ReceivePacket(Ptr<Socket> socket)
 }
 
 // -------------------------
-// Neighbor Count (heuristic) with distance to nearest neighbor
+// Neighbor Count from each vehicle's neighbor table, with distance to the
+// nearest claimed position
 // -------------------------
 void LogNeighbors(NodeContainer nodes)
 {
+  double now = Simulator::Now().GetSeconds();
   for (uint32_t i = 0; i < nodes.GetN(); i++)
   {
-    Ptr<MobilityModel> mob_i = nodes.Get(i)->GetObject<MobilityModel>();
-    Vector pos_i = mob_i->GetPosition();
+    // A vehicle knows its own position, the others only through their BSMs
+    Vector pos_i = nodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
 
-    uint32_t count = 0;
+    NeighborTable& table = neighborTables[i];
+    table.Expire(now, g_neighborTimeout);
+
+    uint32_t count = table.Size();
     double minDistance = std::numeric_limits<double>::max();
 
-    for (uint32_t j = 0; j < nodes.GetN(); j++)
+    for (const NeighborEntry& neighbor : table.Slots())
     {
-      if (i == j) continue;
-      Ptr<MobilityModel> mob_j = nodes.Get(j)->GetObject<MobilityModel>();
-      double distance = mob_i->GetDistanceFrom(mob_j);
-
-      if (distance < 250.0) {  // Communication range approx
-        count++;
-      }
+      if (!neighbor.used) continue;
+      double distance = CalculateDistance(pos_i, neighbor.pos);
 
       // Track minimum distance
       if (distance < minDistance) {
@@ -564,11 +819,7 @@ void LogNeighbors(NodeContainer nodes)
     neighbor_output << Simulator::Now().GetSeconds() << "," << i << "," << count << "," << minDistance << "\n";
 
     // Update features with neighbor information
-    if (nodeFeatures.find(i) != nodeFeatures.end() && !nodeFeatures[i].empty()) {
-      BeaconFeatures& f = nodeFeatures[i].back();  // Get last feature
-      f.neighborCount = count;
-      f.distanceToNearestNeighbor = minDistance;
-    }
+    UpdateNeighborFeatures(i, count, minDistance);
   }
 
   Simulator::Schedule(Seconds(0.2), &LogNeighbors, nodes);
@@ -651,6 +902,11 @@ int main(int argc, char *argv[])
   cmd.AddValue("enable_ml", "Enable ML-based mitigation", g_enable_ml);
   cmd.AddValue("enable_hybrid", "Enable Hybrid mitigation", g_enable_hybrid);
   cmd.AddValue("enable_rule", "Enable Rule-based mitigation", g_enable_rule);
+  cmd.AddValue("featureInterval", "Seconds between features_log rows", g_featureInterval);
+  cmd.AddValue("featureRateTau", "Time constant of the packet-rate EWMA (s)", g_featureRateTau);
+  cmd.AddValue("clusterRadius", "Radius of an identity cluster (m)", g_clusterRadius);
+  cmd.AddValue("neighborCapacity", "Neighbor table slots per vehicle", g_neighborCapacity);
+  cmd.AddValue("neighborTimeout", "Seconds before a silent neighbor is dropped", g_neighborTimeout);
   cmd.Parse(argc, argv);
 
   // Output files
@@ -664,10 +920,10 @@ int main(int argc, char *argv[])
   mitigation_output << "timestamp,nodeId,mitigationType,details" << "\n";
 
   trust_output.open("trust_log.csv");
-  trust_output << "timestamp,nodeId,trustScore,lowTrustFlag" << "\n";
+  trust_output << "timestamp,nodeId,trustScore,lowTrustFlag,observerId" << "\n";
 
   ml_output.open("ml_detection_log.csv");
-  ml_output << "timestamp,nodeId,eventType,suspiciousCount" << "\n";
+  ml_output << "timestamp,nodeId,eventType,suspiciousCount,observerId" << "\n";
 
   neighbor_output.open("neighbor_log.csv");
   neighbor_output << "timestamp,nodeId,neighborCount,minDistance" << "\n";
@@ -685,7 +941,9 @@ int main(int argc, char *argv[])
   msg_falsification_output << "timestamp,attackerId,fakePosX,fakePosY" << "\n";
 
   features_output.open("features_log.csv");
-  features_output << "nodeId,posX,posY,speed,heading,timestamp,interArrivalTime,avgPayloadSize" << "\n";
+  features_output << "nodeId,posX,posY,speed,heading,timestamp,interArrivalTime,avgPayloadSize,"
+                  << "interArrivalStd,payloadSizeStd,packetRate,positionDelta,speedDelta,"
+                  << "neighborCount,distanceToNearestNeighbor,clusterSize" << "\n";
 
   detection_output.open("detection_log.csv");
   detection_output << "timestamp,nodeId,attackType,detectionScore" << "\n";
@@ -693,6 +951,11 @@ int main(int argc, char *argv[])
   NodeContainer vehicles;
   vehicles.Create(g_numVehicles);
 
+  neighborTables.resize(g_numVehicles);
+  for (NeighborTable& table : neighborTables) {
+    table.Init(g_neighborCapacity);
+  }
+
   // Load SUMO mobility (using the same file as before)
   std::string mobilityFile = "/home/jeanhuit/Documents/Workspace/simulation/roads-sumo/2025-12-05-21-50-47/mobility.tcl";
   Ns2MobilityHelper ns2(mobilityFile);
@@ -807,6 +1070,7 @@ int main(int argc, char *argv[])
 
   // Start neighbor logging
   Simulator::Schedule(Seconds(1.0), &LogNeighbors, vehicles);
+  Simulator::Schedule(Seconds(g_featureInterval), &EmitFeatures);
 
   Simulator::Stop(Seconds(g_simTime));
   Simulator::Run();
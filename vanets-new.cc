@@ -4,8 +4,17 @@
  *  - Multiple attacks: DDoS, Sybil, Replay, Jamming, Message Falsification
  *  - Mitigation techniques: Trust-based, ML-based, Hybrid, Rule-based
  *  - Detailed logging for analysis
+ *  - Optional distributed (MPI) execution with geographic partitioning
+ *  - Optional abstract broadcast channel (--abstractChannel) for large fleets
  *
- * Works on NS-3.46 out of the box.
+ * Works on NS-3.46 out of the box. Distributed mode needs ns-3 configured
+ * with --enable-mpi and is started with e.g.
+ *   mpirun -np 4 ./ns3 run vanets-new -- --distributed=true
+ * followed by merge_rank_logs.py to combine the per-rank logs.
+ *
+ * Detector inputs can be recorded with --recordFile=inputs.bin and the
+ * detectors re-run offline with --replayFile=inputs.bin (or an rssi_log.csv),
+ * which writes replay-*_log.csv without simulating the network again.
  */
 
 #include "ns3/core-module.h"
@@ -18,12 +27,34 @@
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/yans-wifi-channel.h"
 #include "ns3/config.h"
+#include "ns3/propagation-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#include "ns3/mpi-receiver.h"
+#include "ns3/distributed-simulator-impl.h"
+#endif
 #include <fstream>
 #include <map>
 #include <vector>
+#include <chrono>
+#include <iostream>
+#include <sys/resource.h>
 #include <algorithm>
 #include <set>
+#include <unordered_map>
 #include <cmath>
+#include <numeric>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <unistd.h>
+#include <sys/wait.h>
 
 using namespace ns3;
 
@@ -51,6 +82,14 @@ static std::ofstream rssi_output;    // RSSI logs
 static uint32_t g_numVehicles = 132;   // Using same as original
 static double g_simTime = 30.0;        // Match our test version
 static double g_bsmInterval = 0.1;     // 10 Hz
+static bool g_benchmark = false;      // Print performance counters at exit
+static double g_commRange = 250.0;     // Communication range approx (m)
+static bool g_rangeCulling = false;    // Only deliver frames to PHYs that can receive them
+static bool g_logRssi = false;         // Write rssi_log.csv (one row per reception)
+static std::string g_replayFile = "";  // Re-run the detectors on a recorded input stream
+static std::string g_labelFile = "";   // attack_log.csv labelling a replayed run
+static std::string g_outputDir = "";   // Prefix of all log paths (branch directory)
+static std::string g_mobilityFile = "/home/jeanhuit/Documents/Workspace/simulation/roads-sumo/2025-12-05-21-50-47/mobility.tcl";
 // Attack parameters
 static bool g_enable_ddos = true;
 static bool g_enable_sybil = true;
@@ -70,17 +109,857 @@ std::set<uint32_t> sybilNodes;
 std::set<uint32_t> jammerNodes;
 std::set<uint32_t> falsifiedNodes;
 
-// Trust system
-std::map<uint32_t, double> nodeTrust; // Trust scores for each node
-std::map<uint32_t, std::vector<double>> trustHistory; // Track trust over time
-
-// ML-based detection
-std::map<uint32_t, std::vector<double>> mobilityHistory; // Store position history
-std::map<uint32_t, int> suspiciousCount; // Suspicious behavior count
+// Periodic detectors, evaluated through the detector graph
+enum DetectorId { DET_TRUST, DET_ML, DET_RULE, DET_HYBRID, DET_COUNT };
+
+// Per-node detector state, one slot per vehicle so that the periodic
+// sweeps can evaluate nodes in parallel without sharing containers
+struct NodeDetectorState {
+  // Trust system
+  double trust = 0.0;                   // Trust score for the node
+  std::vector<double> trustHistory;     // Track trust over time
+  // ML-based detection
+  std::vector<double> mobilityHistory;  // Store position history
+  int suspiciousCount = 0;              // Suspicious behavior count
+  // Rule-based detection
+  std::vector<Time> packetTimestamps;   // Track timestamps
+  // Cached verdict of each detector and the epoch it was computed in
+  uint64_t verdictEpoch[DET_COUNT] = {};  // epoch + 1, 0 = never evaluated
+  bool verdict[DET_COUNT] = {};
+  double score[DET_COUNT] = {};           // Continuous score behind the verdict
+  // Result of the current neighbor sweep
+  uint32_t neighborCount = 0;
+};
+std::vector<NodeDetectorState> nodeState;
 
 // Rule-based detection
 std::map<uint32_t, int> packetFreqCount; // Track packet frequency per node
-std::map<uint32_t, std::vector<Time>> packetTimestamps; // Track timestamps
+std::map<uint32_t, std::vector<Time>> packetTimestamps; // Timestamps of identities that are not vehicles (e.g. Sybil IDs)
+
+// -------------------------
+// Attack Labels (ground truth)
+// -------------------------
+// Every identity that misbehaves (attackers and the fake Sybil IDs) gets an
+// interval per attack, opened on its first malicious transmission and
+// closed when the attack ends or the simulation stops. Closed intervals are
+// written to attack_log.csv, so any record can be labelled with an interval
+// lookup on (id, time) instead of joining the attack logs.
+struct AttackLabel {
+  uint32_t attackerId;
+  std::string type;
+  double start;
+  double end;  // < 0 while the attack is ongoing
+};
+std::map<uint32_t, std::vector<AttackLabel>> attackLabels; // Per identity, ordered by start
+
+void BeginAttackLabel(uint32_t id, uint32_t attackerId, const std::string& type)
+{
+  std::vector<AttackLabel>& labels = attackLabels[id];
+  if (!labels.empty() && labels.back().end < 0) {
+    return; // Already open
+  }
+  labels.push_back({attackerId, type, Simulator::Now().GetSeconds(), -1.0});
+}
+
+void EndAttackLabel(uint32_t id)
+{
+  auto it = attackLabels.find(id);
+  if (it == attackLabels.end() || it->second.empty() || it->second.back().end >= 0) {
+    return;
+  }
+  AttackLabel& label = it->second.back();
+  label.end = Simulator::Now().GetSeconds();
+  attack_output << id << "," << label.attackerId << "," << label.type
+                << "," << label.start << "," << label.end << "\n";
+}
+
+void EndAllAttackLabels()
+{
+  for (auto& entry : attackLabels) {
+    EndAttackLabel(entry.first);
+  }
+}
+
+bool IsAttackLabeled(uint32_t id, double t)
+{
+  auto it = attackLabels.find(id);
+  if (it == attackLabels.end()) {
+    return false;
+  }
+  const std::vector<AttackLabel>& labels = it->second;
+  auto next = std::upper_bound(labels.begin(), labels.end(), t,
+                               [](double time, const AttackLabel& l) { return time < l.start; });
+  if (next == labels.begin()) {
+    return false;
+  }
+  --next;
+  return next->end < 0 || t <= next->end;
+}
+
+// Reads the intervals of a previous run's attack_log.csv (for replays)
+void LoadAttackLabels(const std::string& file)
+{
+  std::ifstream in(file);
+  std::string line;
+  std::getline(in, line); // Header
+  while (std::getline(in, line)) {
+    std::istringstream row(line);
+    std::string id, attackerId, type, start, end;
+    if (std::getline(row, id, ',') && std::getline(row, attackerId, ',') && std::getline(row, type, ',') &&
+        std::getline(row, start, ',') && std::getline(row, end, ',')) {
+      attackLabels[std::stoul(id)].push_back({(uint32_t)std::stoul(attackerId), type, std::stod(start), std::stod(end)});
+    }
+  }
+  for (auto& entry : attackLabels) {
+    std::sort(entry.second.begin(), entry.second.end(),
+              [](const AttackLabel& a, const AttackLabel& b) { return a.start < b.start; });
+  }
+}
+
+// -------------------------
+// Distributed (MPI) Execution
+// -------------------------
+// Vehicles are partitioned into ranks by geographic region. Every rank
+// instantiates all nodes, their mobility and PHYs, but only runs the apps,
+// attacks and detectors of the nodes it owns. Receptions at a node owned by
+// another rank are forwarded to that rank through MPI, delayed by the
+// lookahead (propagation delay over the communication range).
+static bool g_distributed = false;
+static uint32_t g_rank = 0;
+static uint32_t g_numRanks = 1;
+std::vector<uint32_t> nodeRank; // Owning rank of every vehicle
+
+bool IsLocalNode(uint32_t nodeId)
+{
+  return nodeId >= nodeRank.size() || nodeRank[nodeId] == g_rank;
+}
+
+// Per-rank log files are suffixed and merged afterwards by merge_rank_logs.py
+// Logs of an offline replay are prefixed so they sit next to the originals
+std::string LogFileName(const std::string& name)
+{
+  if (!g_replayFile.empty()) {
+    return g_outputDir + "replay-" + name;
+  }
+  if (g_numRanks <= 1) {
+    return g_outputDir + name;
+  }
+  size_t dot = name.rfind('.');
+  return g_outputDir + name.substr(0, dot) + "-rank" + std::to_string(g_rank) + name.substr(dot);
+}
+
+// Lookahead between ranks: a frame cannot reach another region faster than
+// light travels across the communication range.
+Time CrossRankLookahead()
+{
+  return Seconds(g_commRange / 299792458.0);
+}
+
+// First position of every vehicle in an ns-2 mobility trace
+std::vector<Vector> ReadInitialPositions(const std::string& file, uint32_t numNodes)
+{
+  std::vector<Vector> positions(numNodes, Vector(0, 0, 0));
+  std::vector<uint8_t> seen(numNodes, 0); // bit 0: X known, bit 1: Y known
+  std::ifstream in(file);
+  std::string line;
+
+  while (std::getline(in, line))
+  {
+    size_t p = line.find("$node_(");
+    if (p == std::string::npos) continue;
+    uint32_t id = std::stoul(line.substr(p + 7));
+    if (id >= numNodes || seen[id] == 3) continue;
+
+    size_t x = line.find("set X_ ");
+    size_t y = line.find("set Y_ ");
+    size_t d = line.find("setdest ");
+    if (x != std::string::npos) {
+      positions[id].x = std::stod(line.substr(x + 7));
+      seen[id] |= 1;
+    } else if (y != std::string::npos) {
+      positions[id].y = std::stod(line.substr(y + 7));
+      seen[id] |= 2;
+    } else if (d != std::string::npos) {
+      // Vehicles without an initial position start where they first head to
+      std::istringstream dest(line.substr(d + 8));
+      double dx, dy;
+      dest >> dx >> dy;
+      if (!(seen[id] & 1)) positions[id].x = dx;
+      if (!(seen[id] & 2)) positions[id].y = dy;
+      seen[id] = 3;
+    }
+  }
+  return positions;
+}
+
+// Cut the map into stripes along its longer axis with the same number of
+// vehicles in each stripe, one stripe per rank.
+void PartitionByRegion(const std::vector<Vector>& positions, uint32_t numRanks)
+{
+  uint32_t n = positions.size();
+  double minX = 0, maxX = 0, minY = 0, maxY = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    minX = (i == 0) ? positions[i].x : std::min(minX, positions[i].x);
+    maxX = (i == 0) ? positions[i].x : std::max(maxX, positions[i].x);
+    minY = (i == 0) ? positions[i].y : std::min(minY, positions[i].y);
+    maxY = (i == 0) ? positions[i].y : std::max(maxY, positions[i].y);
+  }
+  bool alongX = (maxX - minX) >= (maxY - minY);
+
+  std::vector<uint32_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return alongX ? positions[a].x < positions[b].x : positions[a].y < positions[b].y;
+  });
+
+  nodeRank.assign(n, 0);
+  for (uint32_t k = 0; k < n; k++) {
+    nodeRank[order[k]] = (uint64_t)k * numRanks / n;
+  }
+}
+
+// -------------------------
+// Tabulated Propagation Loss
+// -------------------------
+// Wraps an expensive deterministic model (two-ray ground, log-distance, ...):
+// its path loss is sampled once on a fine distance grid and linearly
+// interpolated at runtime, beyond the table the base model is evaluated
+// directly. Optional Nakagami-m power fading (integer m) is drawn from a
+// counter-based generator keyed by (seed, sender, receiver, time), so a link
+// fades the same whether or not other links were evaluated in between. The
+// fading gain is clamped so the range-culled channel keeps a hard bound.
+class TabulatedPropagationLossModel : public PropagationLossModel
+{
+public:
+  static TypeId GetTypeId()
+  {
+    static TypeId tid = TypeId("ns3::TabulatedPropagationLossModel")
+                            .SetParent<PropagationLossModel>()
+                            .SetGroupName("Propagation")
+                            .AddConstructor<TabulatedPropagationLossModel>();
+    return tid;
+  }
+
+  TabulatedPropagationLossModel()
+  {
+    m_seedVariable = CreateObject<UniformRandomVariable>();
+  }
+
+  // Samples the base model's loss every resolution metres up to maxDistance
+  void Tabulate(Ptr<PropagationLossModel> base, double maxDistance, double resolution)
+  {
+    m_base = base;
+    m_resolution = resolution;
+    m_table.resize((size_t)std::ceil(maxDistance / resolution) + 1);
+
+    Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel>();
+    Ptr<MobilityModel> b = CreateObject<ConstantPositionMobilityModel>();
+    for (size_t k = 0; k < m_table.size(); k++) {
+      b->SetPosition(Vector(k * resolution, 0, 0));
+      m_table[k] = (float)(0.0 - m_base->CalcRxPower(0.0, a, b)); // Loss (dB)
+    }
+    m_maxDistance = (m_table.size() - 1) * resolution;
+  }
+
+  // Nakagami shape (0 disables fading) and the clamp of the fading gain (dB)
+  void SetFading(uint32_t m, double maxGainDb)
+  {
+    m_fadingM = m;
+    m_maxFadingGainDb = maxGainDb;
+  }
+
+  // Deterministic power plus the largest fading gain, used for culling
+  double CalcRxPowerBound(double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    return PathRxPower(txPowerDbm, a, b) + (m_fadingM > 0 ? m_maxFadingGainDb : 0.0);
+  }
+
+private:
+  double DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const override
+  {
+    double rxPower = PathRxPower(txPowerDbm, a, b);
+    if (m_fadingM > 0) {
+      rxPower += FadingGainDb(a, b);
+    }
+    return rxPower;
+  }
+
+  int64_t DoAssignStreams(int64_t stream) override
+  {
+    m_seedVariable->SetStream(stream);
+    return 1;
+  }
+
+  double PathRxPower(double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    double d = a->GetDistanceFrom(b);
+    if (d >= m_maxDistance) {
+      return m_base->CalcRxPower(txPowerDbm, a, b);
+    }
+    double x = d / m_resolution;
+    size_t k = (size_t)x;
+    double frac = x - k;
+    return txPowerDbm - (m_table[k] + frac * (m_table[k + 1] - m_table[k]));
+  }
+
+  static uint64_t SplitMix64(uint64_t& state)
+  {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  static uint32_t NodeIdOf(Ptr<MobilityModel> mobility)
+  {
+    Ptr<Node> node = mobility->GetObject<Node>();
+    return node ? node->GetId() : 0xffffffff;
+  }
+
+  // Gamma(m, 1/m) power gain as the mean of m unit exponentials
+  double FadingGainDb(Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    if (!m_seeded) {
+      m_seed = ((uint64_t)m_seedVariable->GetInteger(0, 0xffffffff) << 32) |
+               m_seedVariable->GetInteger(0, 0xffffffff);
+      m_seeded = true;
+    }
+    uint64_t state = m_seed ^ (((uint64_t)NodeIdOf(a) << 32) | NodeIdOf(b));
+    state ^= SplitMix64(state) + (uint64_t)Simulator::Now().GetTimeStep();
+
+    double sum = 0;
+    for (uint32_t i = 0; i < m_fadingM; i++) {
+      double u = ((SplitMix64(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0); // (0, 1)
+      sum -= std::log(u);
+    }
+    return std::min(10.0 * std::log10(sum / m_fadingM), m_maxFadingGainDb);
+  }
+
+  Ptr<PropagationLossModel> m_base;
+  std::vector<float> m_table;       // Path loss (dB) per distance step
+  double m_resolution = 1.0;
+  double m_maxDistance = 0;
+  uint32_t m_fadingM = 0;
+  double m_maxFadingGainDb = 10.0;
+  Ptr<UniformRandomVariable> m_seedVariable;
+  mutable uint64_t m_seed = 0;
+  mutable bool m_seeded = false;
+};
+NS_OBJECT_ENSURE_REGISTERED(TabulatedPropagationLossModel);
+
+static std::string g_lossModel = "ns3::FriisPropagationLossModel";
+static bool g_tabulateLoss = false;       // Interpolate g_lossModel from a table
+static double g_lossTableRange = 5000.0;  // Tabulated distance (m)
+static double g_lossTableStep = 1.0;      // Table resolution (m)
+static uint32_t g_fadingM = 0;            // Nakagami m of the tabulated model, 0 = no fading
+static double g_maxFadingGain = 10.0;     // Clamp of the fading gain (dB)
+
+Ptr<PropagationLossModel> CreateLossModel()
+{
+  ObjectFactory factory;
+  factory.SetTypeId(TypeId::LookupByName(g_lossModel));
+  Ptr<PropagationLossModel> base = factory.Create<PropagationLossModel>();
+  if (!g_tabulateLoss) {
+    return base;
+  }
+  Ptr<TabulatedPropagationLossModel> tabulated = CreateObject<TabulatedPropagationLossModel>();
+  tabulated->Tabulate(base, g_lossTableRange, g_lossTableStep);
+  tabulated->SetFading(g_fadingM, g_maxFadingGain);
+  return tabulated;
+}
+
+// -------------------------
+// Mobility Grid
+// -------------------------
+// Uniform grid over a set of mobility models for range queries. Entries are
+// bucketed at their position of the last rebuild or course change; between
+// those they move in straight lines at most maxSpeed, so widening the query
+// by the accumulated drift keeps the result a superset of the true
+// neighbours. The grid rebuilds itself once the drift reaches half a cell.
+class MobilityGrid
+{
+public:
+  void Build(const std::vector<Ptr<MobilityModel>>& mobility, double cellSize)
+  {
+    m_mobility = mobility;
+    m_cellSize = std::max(1.0, cellSize);
+    m_index.clear();
+    for (uint32_t i = 0; i < m_mobility.size(); i++) {
+      m_index[PeekPointer(m_mobility[i])] = i;
+      m_mobility[i]->TraceConnectWithoutContext("CourseChange", MakeCallback(&MobilityGrid::CourseChanged, this));
+    }
+    Refresh();
+  }
+
+  // Indices of all entries possibly within radius of pos, ascending
+  void Query(const Vector& pos, double radius, std::vector<uint32_t>& out)
+  {
+    double drift = m_maxSpeed * (Simulator::Now() - m_lastRefresh).GetSeconds();
+    if (drift > m_cellSize / 2) {
+      Refresh();
+      drift = 0;
+    }
+
+    double reach = radius + drift;
+    int64_t span = (int64_t)std::ceil(reach / m_cellSize);
+    int64_t cx = Cell(pos.x);
+    int64_t cy = Cell(pos.y);
+
+    out.clear();
+    for (int64_t x = cx - span; x <= cx + span; x++) {
+      for (int64_t y = cy - span; y <= cy + span; y++) {
+        auto cell = m_cells.find(CellKey(x, y));
+        if (cell == m_cells.end()) continue;
+        for (uint32_t index : cell->second) {
+          double dx = m_bucketPos[index].x - pos.x;
+          double dy = m_bucketPos[index].y - pos.y;
+          if (dx * dx + dy * dy <= reach * reach) {
+            out.push_back(index);
+          }
+        }
+      }
+    }
+    std::sort(out.begin(), out.end());
+  }
+
+private:
+  int64_t Cell(double coord) const
+  {
+    return (int64_t)std::floor(coord / m_cellSize);
+  }
+
+  static uint64_t CellKey(int64_t x, int64_t y)
+  {
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+  }
+
+  void Bucket(uint32_t index)
+  {
+    m_bucketPos[index] = m_mobility[index]->GetPosition();
+    uint64_t key = CellKey(Cell(m_bucketPos[index].x), Cell(m_bucketPos[index].y));
+    m_cells[key].push_back(index);
+    m_cellOf[index] = key;
+  }
+
+  void Unbucket(uint32_t index)
+  {
+    std::vector<uint32_t>& cell = m_cells[m_cellOf[index]];
+    cell.erase(std::find(cell.begin(), cell.end(), index));
+  }
+
+  // Rebuckets every entry; positions are then exact as of now
+  void Refresh()
+  {
+    m_cells.clear();
+    m_bucketPos.assign(m_mobility.size(), Vector(0, 0, 0));
+    m_cellOf.assign(m_mobility.size(), 0);
+    m_maxSpeed = 0;
+    for (uint32_t i = 0; i < m_mobility.size(); i++) {
+      Bucket(i);
+      Vector v = m_mobility[i]->GetVelocity();
+      m_maxSpeed = std::max(m_maxSpeed, std::sqrt(v.x * v.x + v.y * v.y));
+    }
+    m_lastRefresh = Simulator::Now();
+  }
+
+  // Velocity changes and jumps: rebucket so the drift bound keeps holding
+  void CourseChanged(Ptr<const MobilityModel> mobility)
+  {
+    auto it = m_index.find(PeekPointer(mobility));
+    if (it == m_index.end()) return;
+    Unbucket(it->second);
+    Bucket(it->second);
+    Vector v = mobility->GetVelocity();
+    m_maxSpeed = std::max(m_maxSpeed, std::sqrt(v.x * v.x + v.y * v.y));
+  }
+
+  std::vector<Ptr<MobilityModel>> m_mobility;
+  std::unordered_map<const MobilityModel*, uint32_t> m_index;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> m_cells;
+  std::vector<Vector> m_bucketPos;               // Position when bucketed
+  std::vector<uint64_t> m_cellOf;
+  double m_cellSize = 1.0;
+  double m_maxSpeed = 0;                         // Since the last refresh
+  Time m_lastRefresh;
+};
+
+// -------------------------
+// Range-Culled Wifi Channel
+// -------------------------
+// YansWifiChannel schedules a reception at every PHY for every frame and
+// only drops frames below the RX sensitivity when they arrive. This channel
+// finds the candidate receivers in a MobilityGrid instead and schedules
+// only those whose received power passes the same check, so the frames a
+// PHY actually processes (and their order) are unchanged. The loss model
+// must be non-increasing with distance and either deterministic or a
+// tabulated model with clamped fading; the culling radius is found by
+// probing it (its upper bound).
+class RangeCulledWifiChannel : public YansWifiChannel
+{
+public:
+  static TypeId GetTypeId()
+  {
+    static TypeId tid = TypeId("ns3::RangeCulledWifiChannel")
+                            .SetParent<YansWifiChannel>()
+                            .SetGroupName("Wifi")
+                            .AddConstructor<RangeCulledWifiChannel>();
+    return tid;
+  }
+
+  void SetModels(Ptr<PropagationLossModel> loss, Ptr<PropagationDelayModel> delay)
+  {
+    SetPropagationLossModel(loss);
+    SetPropagationDelayModel(delay);
+    m_loss = loss;
+    m_delay = delay;
+  }
+
+  void Send(Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, dBm_u txPower)
+  {
+    if (m_phys.empty()) {
+      Initialize();
+    }
+
+    // Same threshold as the reception check, for the narrowest receiver
+    dBm_u threshold = m_minRxSensitivity + RatioToDb(ppdu->GetTxVector().GetChannelWidth() / 20.0);
+    double range = CullRange(txPower, threshold);
+
+    // Candidates come back in PHY list order, as YansWifiChannel delivers
+    Ptr<MobilityModel> senderMobility = sender->GetMobility();
+    m_grid.Query(senderMobility->GetPosition(), range, m_candidates);
+
+    for (uint32_t index : m_candidates) {
+      Ptr<YansWifiPhy> receiver = m_phys[index];
+      if (receiver == sender || receiver->GetChannelNumber() != sender->GetChannelNumber()) {
+        continue;
+      }
+      Ptr<MobilityModel> receiverMobility = m_mobility[index];
+      dBm_u rxPower = m_loss->CalcRxPower(txPower, senderMobility, receiverMobility);
+      if (rxPower - RatioToDb(ppdu->GetTxVector().GetChannelWidth() / 20.0) < receiver->GetRxSensitivity()) {
+        continue; // Would be dropped on arrival
+      }
+      Time delay = m_delay->GetDelay(senderMobility, receiverMobility);
+      uint32_t dstNode = receiver->GetDevice() ? receiver->GetDevice()->GetNode()->GetId() : 0xffffffff;
+      Simulator::ScheduleWithContext(dstNode, delay, &RangeCulledWifiChannel::Receive,
+                                     receiver, ppdu->Copy(), rxPower);
+    }
+  }
+
+private:
+  // Mirrors YansWifiChannel::Receive for frames that passed the threshold
+  static void Receive(Ptr<YansWifiPhy> phy, Ptr<const WifiPpdu> ppdu, dBm_u rxPower)
+  {
+    RxPowerWattPerChannelBand rxPowerW;
+    rxPowerW.insert({{{{0, 0}}, {{0, 0}}}, DbmToW(rxPower + phy->GetRxGain())});
+    phy->StartReceivePreamble(ppdu, rxPowerW, ppdu->GetTxDuration());
+  }
+
+  void Initialize()
+  {
+    m_minRxSensitivity = std::numeric_limits<double>::infinity();
+    dBm_u maxTxPower = -std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < GetNDevices(); i++) {
+      Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice>(GetDevice(i));
+      Ptr<YansWifiPhy> phy = DynamicCast<YansWifiPhy>(dev->GetPhy());
+      m_phys.push_back(phy);
+      m_mobility.push_back(phy->GetMobility());
+      m_minRxSensitivity = std::min(m_minRxSensitivity, phy->GetRxSensitivity());
+      maxTxPower = std::max(maxTxPower, phy->GetTxPowerEnd() + phy->GetTxGain());
+    }
+    // Cells span the longest reach at the 20 MHz threshold
+    m_grid.Build(m_mobility, CullRange(maxTxPower, m_minRxSensitivity));
+  }
+
+  // Largest distance at which the loss model still yields threshold
+  double CullRange(dBm_u txPower, dBm_u threshold)
+  {
+    auto key = std::make_pair(txPower, threshold);
+    auto cached = m_rangeCache.find(key);
+    if (cached != m_rangeCache.end()) {
+      return cached->second;
+    }
+
+    Ptr<MobilityModel> a = CreateObject<ConstantPositionMobilityModel>();
+    Ptr<MobilityModel> b = CreateObject<ConstantPositionMobilityModel>();
+    Ptr<TabulatedPropagationLossModel> tabulated = DynamicCast<TabulatedPropagationLossModel>(m_loss);
+    auto reaches = [&](double d) {
+      b->SetPosition(Vector(d, 0, 0));
+      double rxPower = tabulated ? tabulated->CalcRxPowerBound(txPower, a, b)
+                                 : m_loss->CalcRxPower(txPower, a, b);
+      return rxPower >= threshold;
+    };
+    double lo = 0, hi = 1;
+    while (reaches(hi) && hi < 1e8) {
+      lo = hi;
+      hi *= 2;
+    }
+    for (int k = 0; k < 64; k++) {
+      double mid = (lo + hi) / 2;
+      (reaches(mid) ? lo : hi) = mid;
+    }
+    double range = hi + 1.0; // Round up so the grid stays a superset
+    m_rangeCache[key] = range;
+    return range;
+  }
+
+  Ptr<PropagationLossModel> m_loss;
+  Ptr<PropagationDelayModel> m_delay;
+  std::vector<Ptr<YansWifiPhy>> m_phys;          // Channel order
+  std::vector<Ptr<MobilityModel>> m_mobility;
+  MobilityGrid m_grid;
+  std::vector<uint32_t> m_candidates;
+  std::map<std::pair<double, double>, double> m_rangeCache;
+  dBm_u m_minRxSensitivity = 0;
+};
+NS_OBJECT_ENSURE_REGISTERED(RangeCulledWifiChannel);
+
+// Hands its frames to a RangeCulledWifiChannel instead of YansWifiChannel::Send
+class RangeCulledWifiPhy : public YansWifiPhy
+{
+public:
+  static TypeId GetTypeId()
+  {
+    static TypeId tid = TypeId("ns3::RangeCulledWifiPhy")
+                            .SetParent<YansWifiPhy>()
+                            .SetGroupName("Wifi")
+                            .AddConstructor<RangeCulledWifiPhy>();
+    return tid;
+  }
+
+  void StartTx(Ptr<const WifiPpdu> ppdu) override
+  {
+    Ptr<RangeCulledWifiChannel> channel = DynamicCast<RangeCulledWifiChannel>(GetChannel());
+    channel->Send(this, ppdu, GetTxPowerForTransmission(ppdu) + GetTxGain());
+  }
+};
+NS_OBJECT_ENSURE_REGISTERED(RangeCulledWifiPhy);
+
+class CullingWifiPhyHelper : public YansWifiPhyHelper
+{
+public:
+  // Installs RangeCulledWifiPhy; the channel must be a RangeCulledWifiChannel
+  void EnableRangeCulling()
+  {
+    m_phys.front().SetTypeId(RangeCulledWifiPhy::GetTypeId());
+  }
+};
+
+// -------------------------
+// Abstract Broadcast Channel
+// -------------------------
+// --abstractChannel replaces the 802.11p devices and the IP stack for large
+// detector experiments: a broadcast reaches every vehicle within commRange
+// after the propagation delay and one frame airtime. Decoding succeeds with
+// probability 1 up to abstractReliableRange, falling linearly to 0 at
+// commRange. A sender transmits its frames back to back; with collisions
+// enabled, frames overlapping at a receiver are all lost (the jammer's
+// frames only occupy the channel).
+static bool g_abstractChannel = false;
+static double g_abstractReliableRange = 150.0;  // Distance of certain reception (m)
+static bool g_abstractCollisions = true;
+
+void ProcessBsm(Ptr<Node> node, Ptr<Packet> packet);
+
+class AbstractBroadcastChannel
+{
+public:
+  void Install(NodeContainer nodes)
+  {
+    m_nodes = nodes;
+    std::vector<Ptr<MobilityModel>> mobility;
+    for (uint32_t i = 0; i < nodes.GetN(); i++) {
+      mobility.push_back(nodes.Get(i)->GetObject<MobilityModel>());
+    }
+    m_mobility = mobility;
+    m_grid.Build(mobility, g_commRange);
+    m_txBusyUntil.assign(nodes.GetN(), Seconds(0));
+    m_rxBusyUntil.assign(nodes.GetN(), Seconds(0));
+    m_pending.assign(nodes.GetN(), EventId());
+    m_random = CreateObject<UniformRandomVariable>();
+  }
+
+  // Queues a frame at the sender; deliver=false frames only occupy the channel
+  void Broadcast(uint32_t sender, Ptr<Packet> packet, bool deliver)
+  {
+    Time airtime = Airtime(packet->GetSize());
+    Time start = Max(Simulator::Now(), m_txBusyUntil[sender]);
+    m_txBusyUntil[sender] = start + airtime;
+    if (start > Simulator::Now()) {
+      Simulator::Schedule(start - Simulator::Now(), &AbstractBroadcastChannel::StartTx,
+                          this, sender, packet, deliver, airtime);
+    } else {
+      StartTx(sender, packet, deliver, airtime);
+    }
+  }
+
+private:
+  // 802.11p at 6 Mbps in 10 MHz: 40 us preamble and header, 24 bits per
+  // 8 us symbol; the payload carries a MAC header, LLC/SNAP and the FCS.
+  static Time Airtime(uint32_t size)
+  {
+    uint32_t bits = 16 + 8 * (size + 36) + 6;
+    return MicroSeconds(40 + 8 * ((bits + 23) / 24));
+  }
+
+  double RxProbability(double d) const
+  {
+    if (d <= g_abstractReliableRange) return 1.0;
+    if (d >= g_commRange) return 0.0;
+    return (g_commRange - d) / (g_commRange - g_abstractReliableRange);
+  }
+
+  void StartTx(uint32_t sender, Ptr<Packet> packet, bool deliver, Time airtime)
+  {
+    Vector pos = m_mobility[sender]->GetPosition();
+    m_grid.Query(pos, g_commRange, m_candidates);
+    for (uint32_t r : m_candidates) {
+      if (r == sender) continue;
+      double d = CalculateDistance(pos, m_mobility[r]->GetPosition());
+      if (d > g_commRange) continue;
+      bool decodable = deliver && m_random->GetValue() < RxProbability(d);
+      Simulator::ScheduleWithContext(r, Seconds(d / 299792458.0), &AbstractBroadcastChannel::Arrive,
+                                     this, r, packet, decodable, airtime);
+    }
+  }
+
+  void Arrive(uint32_t receiver, Ptr<Packet> packet, bool decodable, Time airtime)
+  {
+    Time end = Simulator::Now() + airtime;
+    if (g_abstractCollisions && Simulator::Now() < m_rxBusyUntil[receiver]) {
+      // Overlap: the frame being received and this one are both lost
+      m_pending[receiver].Cancel();
+      m_rxBusyUntil[receiver] = Max(m_rxBusyUntil[receiver], end);
+      return;
+    }
+    m_rxBusyUntil[receiver] = end;
+    if (decodable) {
+      m_pending[receiver] = Simulator::Schedule(airtime, &AbstractBroadcastChannel::Deliver,
+                                                this, receiver, packet);
+    }
+  }
+
+  void Deliver(uint32_t receiver, Ptr<Packet> packet)
+  {
+    ProcessBsm(m_nodes.Get(receiver), packet->Copy());
+  }
+
+  NodeContainer m_nodes;
+  std::vector<Ptr<MobilityModel>> m_mobility;
+  MobilityGrid m_grid;
+  std::vector<uint32_t> m_candidates;
+  std::vector<Time> m_txBusyUntil;   // End of the sender's queued frames
+  std::vector<Time> m_rxBusyUntil;   // End of the frames overlapping at a receiver
+  std::vector<EventId> m_pending;    // Delivery of the frame being received
+  Ptr<UniformRandomVariable> m_random;
+};
+static AbstractBroadcastChannel abstractChannel;
+
+// -------------------------
+// WSMP-style Link Layer
+// -------------------------
+// --wsmp sends BSMs as raw 802.11 broadcast frames with their own EtherType
+// (LLC/SNAP, as WSMP does) and receives them through a protocol handler,
+// so no IPv4/ARP/UDP is installed on the vehicles.
+static bool g_wsmp = false;
+static const uint16_t g_bsmEtherType = 0x88DC;  // WSMP
+static const uint16_t g_jamEtherType = 0x88B5;  // Local experimental, no receiver
+
+void SendRaw(Ptr<Node> node, Ptr<Packet> p, uint16_t etherType)
+{
+  Ptr<NetDevice> dev = node->GetDevice(0);
+  dev->Send(p, dev->GetBroadcast(), etherType);
+}
+
+// -------------------------
+// Beacon Scheduler
+// -------------------------
+// With --beaconWheel the BSM apps do not schedule themselves. They register
+// here and are dispatched from a single timer over a wheel of beaconSlot
+// wide slots, so there is one scheduler event per occupied slot instead of
+// one per vehicle and beacon. Each vehicle gets a random phase within the
+// beacon interval and every beacon a random jitter of up to beaconJitter,
+// drawn from an ns-3 stream (reproducible per seed/run). Beacon times are
+// quantized to the slot; vehicles sharing a slot fire in node order.
+static bool g_beaconWheel = false;
+static double g_beaconSlot = 0.001;    // Slot width (s)
+static double g_beaconJitter = 0.002;  // Per-beacon jitter (s)
+
+class BeaconScheduler
+{
+public:
+  // fire() sends one beacon; the first one goes out within one interval of now
+  void Add(uint32_t nodeId, double interval, Callback<void> fire)
+  {
+    if (m_slots.empty()) {
+      m_random = CreateObject<UniformRandomVariable>();
+      uint64_t maxPeriod = (uint64_t)std::ceil((interval + g_beaconJitter) / g_beaconSlot) + 1;
+      m_slots.resize(2 * maxPeriod);
+    }
+    uint64_t now = CurrentSlot();
+    uint64_t phase = (uint64_t)(m_random->GetValue(0, interval) / g_beaconSlot);
+    m_entries.push_back({nodeId, interval, fire});
+    Insert(now + phase, m_entries.size() - 1);
+  }
+
+private:
+  struct Entry {
+    uint32_t nodeId;
+    double interval;
+    Callback<void> fire;
+  };
+
+  uint64_t CurrentSlot() const
+  {
+    return (uint64_t)std::ceil(Simulator::Now().GetSeconds() / g_beaconSlot - 1e-9);
+  }
+
+  void Insert(uint64_t slot, uint32_t entry)
+  {
+    m_slots[slot % m_slots.size()].push_back(entry);
+    if (!m_timer.IsPending() || slot < m_timerSlot) {
+      m_timer.Cancel();
+      m_timerSlot = slot;
+      m_timer = Simulator::Schedule(UntilSlot(slot), &BeaconScheduler::Dispatch, this);
+    }
+  }
+
+  Time UntilSlot(uint64_t slot) const
+  {
+    return Max(Seconds(slot * g_beaconSlot) - Simulator::Now(), Seconds(0));
+  }
+
+  void Dispatch()
+  {
+    uint64_t slot = m_timerSlot;
+    std::vector<uint32_t> due;
+    due.swap(m_slots[slot % m_slots.size()]);
+    std::sort(due.begin(), due.end(), [this](uint32_t a, uint32_t b) {
+      return m_entries[a].nodeId < m_entries[b].nodeId;
+    });
+
+    for (uint32_t e : due) {
+      m_entries[e].fire();
+      double next = m_entries[e].interval + m_random->GetValue(0, g_beaconJitter);
+      m_slots[(slot + std::max<uint64_t>(1, (uint64_t)std::llround(next / g_beaconSlot))) % m_slots.size()].push_back(e);
+    }
+
+    // Next occupied slot; the wheel spans more than one interval plus jitter
+    for (uint64_t k = 1; k <= m_slots.size(); k++) {
+      if (!m_slots[(slot + k) % m_slots.size()].empty()) {
+        m_timerSlot = slot + k;
+        m_timer = Simulator::Schedule(UntilSlot(m_timerSlot), &BeaconScheduler::Dispatch, this);
+        return;
+      }
+    }
+  }
+
+  std::vector<Entry> m_entries;
+  std::vector<std::vector<uint32_t>> m_slots;  // Entry indices per slot
+  EventId m_timer;
+  uint64_t m_timerSlot = 0;
+  Ptr<UniformRandomVariable> m_random;
+};
+static BeaconScheduler beaconScheduler;
 
 // -------------------------------
 // Enhanced BSM Application with Attack Capabilities
@@ -99,6 +978,13 @@ public:
     m_isAttacker = isAttacker;
   }
 
+  // Switches the role of a running app (branch mode)
+  void SetAttack(std::string attackType, bool isAttacker)
+  {
+    m_attackType = attackType;
+    m_isAttacker = isAttacker;
+  }
+
 private:
   Ptr<Socket> m_socket;
   Ptr<Node> m_node;
@@ -108,9 +994,27 @@ private:
 
   virtual void StartApplication()
   {
+    if (g_beaconWheel) {
+      beaconScheduler.Add(m_node->GetId(), m_interval, MakeCallback(&EnhancedBsmApp::SendBsm, this));
+      return;
+    }
     SendBsm();
   }
 
+  // Hands a frame to the configured link
+  void Transmit(Ptr<Packet> p)
+  {
+    if (g_abstractChannel) {
+      abstractChannel.Broadcast(m_node->GetId(), p, true);
+      return;
+    }
+    if (g_wsmp) {
+      SendRaw(m_node, p, g_bsmEtherType);
+      return;
+    }
+    m_socket->Send(p);
+  }
+
   void SendBsm()
   {
     Ptr<MobilityModel> mob = m_node->GetObject<MobilityModel>();
@@ -131,10 +1035,11 @@ private:
     {
       if (m_attackType == "ddos")
       {
+        BeginAttackLabel(m_node->GetId(), m_node->GetId(), "ddos");
         // DDoS: send multiple packets in rapid succession
         for (int i = 0; i < 10; i++) { // Send 10 packets at once
           Ptr<Packet> p = Create<Packet>((const uint8_t*)s.c_str(), s.length());
-          m_socket->Send(p);
+          Transmit(p);
           
           ddos_output << Simulator::Now().GetSeconds() 
                     << "," << m_node->GetId() 
@@ -143,9 +1048,11 @@ private:
       }
       else if (m_attackType == "sybil")
       {
+        BeginAttackLabel(m_node->GetId(), m_node->GetId(), "sybil");
         // Sybil: send with multiple fake IDs
         for (int i = 1; i <= 5; i++) { // Create 5 fake identities
           uint32_t fakeId = m_node->GetId() * 1000 + i;
+          BeginAttackLabel(fakeId, m_node->GetId(), "sybil");
           std::ostringstream fakeMsg;
           fakeMsg << "BSM," << fakeId
                   << "," << (pos.x + i*10) << "," << (pos.y + i*10)  // Slightly different positions
@@ -154,7 +1061,7 @@ private:
 
           std::string fakeS = fakeMsg.str();
           Ptr<Packet> p = Create<Packet>((const uint8_t*)fakeS.c_str(), fakeS.length());
-          m_socket->Send(p);
+          Transmit(p);
           
           sybil_output << Simulator::Now().GetSeconds() 
                      << "," << fakeId 
@@ -166,9 +1073,10 @@ private:
       {
         // Replay: send buffered packets from the past
         if (!replayBuffers[m_node->GetId()].empty()) {
+          BeginAttackLabel(m_node->GetId(), m_node->GetId(), "replay");
           std::string replayMsg = replayBuffers[m_node->GetId()].back();
           Ptr<Packet> p = Create<Packet>((const uint8_t*)replayMsg.c_str(), replayMsg.length());
-          m_socket->Send(p);
+          Transmit(p);
           
           replay_output << Simulator::Now().GetSeconds() 
                       << "," << m_node->GetId() 
@@ -178,6 +1086,7 @@ private:
       else if (m_attackType == "falsification")
       {
         // Message falsification: send false position/velocity data
+        BeginAttackLabel(m_node->GetId(), m_node->GetId(), "falsification");
         std::ostringstream fakeMsg;
         fakeMsg << "BSM," << m_node->GetId()
                 << "," << (pos.x + 500) << "," << (pos.y + 500)  // Falsified position
@@ -186,7 +1095,7 @@ private:
 
         std::string fakeS = fakeMsg.str();
         Ptr<Packet> p = Create<Packet>((const uint8_t*)fakeS.c_str(), fakeS.length());
-        m_socket->Send(p);
+        Transmit(p);
         
         msg_falsification_output << Simulator::Now().GetSeconds() 
                                << "," << m_node->GetId() 
@@ -196,14 +1105,14 @@ private:
       {
         // Normal packet transmission
         Ptr<Packet> p = Create<Packet>((const uint8_t*)s.c_str(), s.length());
-        m_socket->Send(p);
+        Transmit(p);
       }
     }
     else
     {
       // Normal packet transmission
       Ptr<Packet> p = Create<Packet>((const uint8_t*)s.c_str(), s.length());
-      m_socket->Send(p);
+      Transmit(p);
     }
 
     // Buffer for replay attack (for all nodes, so attackers can replay)
@@ -217,10 +1126,140 @@ private:
             << "," << Simulator::Now().GetSeconds() << "\n";
 
     // Schedule next transmission
-    Simulator::Schedule(Seconds(m_interval), &EnhancedBsmApp::SendBsm, this);
+    if (!g_beaconWheel) {
+      Simulator::Schedule(Seconds(m_interval), &EnhancedBsmApp::SendBsm, this);
+    }
+  }
+};
+
+// -------------------------
+// Parallel Detector Sweeps
+// -------------------------
+// The periodic detectors evaluate every vehicle independently. Each sweep
+// first takes a snapshot of all positions/velocities on the simulator
+// thread, then evaluates the nodes on a worker pool (static chunks) while
+// the event loop waits. Workers only touch the slot of the node they
+// evaluate; logging happens afterwards on the simulator thread in node order,
+// so the output is identical to a serial sweep.
+static uint32_t g_detectorThreads = 1;  // 1 = evaluate inline
+
+class SweepPool
+{
+public:
+  ~SweepPool() { Stop(); }
+
+  void Start(uint32_t threads)
+  {
+    Stop();
+    m_stop = false;
+    m_numChunks = std::max(threads, 1u);
+    // The calling thread works on chunk 0
+    for (uint32_t k = 1; k < m_numChunks; k++) {
+      m_threads.emplace_back(&SweepPool::Worker, this, k);
+    }
+  }
+
+  void Stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_start.notify_all();
+    for (std::thread& t : m_threads) {
+      t.join();
+    }
+    m_threads.clear();
+    m_numChunks = 1;
+  }
+
+  // Runs fn(begin, end) over [0, n) and returns once every chunk is done
+  void Run(uint32_t n, const std::function<void(uint32_t, uint32_t)>& fn)
+  {
+    if (m_threads.empty()) {
+      fn(0, n);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_fn = &fn;
+      m_n = n;
+      m_pending = m_threads.size();
+      m_generation++;
+    }
+    m_start.notify_all();
+
+    fn(0, ChunkEnd(0));
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+    m_fn = nullptr;
+  }
+
+private:
+  uint32_t ChunkEnd(uint32_t k) const
+  {
+    return (uint64_t)m_n * (k + 1) / m_numChunks;
+  }
+
+  void Worker(uint32_t k)
+  {
+    uint64_t seen = 0;
+    while (true)
+    {
+      const std::function<void(uint32_t, uint32_t)>* fn;
+      uint32_t begin, end;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_start.wait(lock, [&] { return m_stop || m_generation != seen; });
+        if (m_stop) return;
+        seen = m_generation;
+        fn = m_fn;
+        begin = ChunkEnd(k - 1);
+        end = ChunkEnd(k);
+      }
+      (*fn)(begin, end);
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending--;
+      }
+      m_done.notify_one();
+    }
   }
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_start;
+  std::condition_variable m_done;
+  const std::function<void(uint32_t, uint32_t)>* m_fn = nullptr;
+  uint32_t m_n = 0;
+  uint32_t m_numChunks = 1;
+  uint32_t m_pending = 0;
+  uint64_t m_generation = 0;
+  bool m_stop = false;
 };
 
+static SweepPool sweepPool;
+
+// Kinematics of every vehicle at the current tick (all ranks keep the
+// mobility of every node, so ghosts are included for the neighbor count)
+struct NodeSnapshot {
+  Vector pos;
+  Vector vel;
+};
+std::vector<NodeSnapshot> tickSnapshot;
+
+void TakeTickSnapshot(NodeContainer nodes)
+{
+  tickSnapshot.resize(nodes.GetN());
+  for (uint32_t i = 0; i < nodes.GetN(); i++)
+  {
+    Ptr<MobilityModel> mob = nodes.Get(i)->GetObject<MobilityModel>();
+    tickSnapshot[i].pos = mob->GetPosition();
+    tickSnapshot[i].vel = mob->GetVelocity();
+  }
+}
+
 // -------------------------
 // Trust-based Mitigation System
 // -------------------------
@@ -239,49 +1278,25 @@ double calculateTrustScore(uint32_t nodeId, Vector pos, Vector vel, Time timesta
   }
 
   // Add to trust history
-  trustHistory[nodeId].push_back(trust);
-  if (trustHistory[nodeId].size() > 100) { // Only keep recent history
-    trustHistory[nodeId].erase(trustHistory[nodeId].begin());
+  std::vector<double>& history = nodeState[nodeId].trustHistory;
+  history.push_back(trust);
+  if (history.size() > 100) { // Only keep recent history
+    history.erase(history.begin());
   }
 
   // Calculate average trust over time
   double avgTrust = trust;
-  if (!trustHistory[nodeId].empty()) {
+  if (!history.empty()) {
     double sum = 0;
-    for (double t : trustHistory[nodeId]) {
+    for (double t : history) {
       sum += t;
     }
-    avgTrust = sum / trustHistory[nodeId].size();
+    avgTrust = sum / history.size();
   }
 
   return avgTrust;
 }
 
-// Update trust scores
-void UpdateTrustScores(NodeContainer nodes)
-{
-  for (uint32_t i = 0; i < nodes.GetN(); i++)
-  {
-    Ptr<MobilityModel> mob = nodes.Get(i)->GetObject<MobilityModel>();
-    Vector pos = mob->GetPosition();
-    Vector vel = mob->GetVelocity();
-    
-    double trust = calculateTrustScore(i, pos, vel, Simulator::Now());
-    
-    // Update global trust score
-    nodeTrust[i] = trust;
-    
-    // Log trust score
-    trust_output << Simulator::Now().GetSeconds() 
-                << "," << i 
-                << "," << trust 
-                << "," << (trust < 0.5 ? 1 : 0)  // Flag if low trust
-                << "\n";
-  }
-
-  Simulator::Schedule(Seconds(1.0), &UpdateTrustScores, nodes);
-}
-
 // -------------------------
 // ML-based Detection (Simple Anomaly Detection)
 // -------------------------
@@ -289,61 +1304,40 @@ bool detectAnomaly(uint32_t nodeId, Vector pos, Vector vel)
 {
   // Simple ML-based detection: check for anomalous behavior
   bool isAnomaly = false;
-  
+  NodeDetectorState& state = nodeState[nodeId];
+
   // Check if velocity is outside normal bounds
   double speed = sqrt(vel.x*vel.x + vel.y*vel.y);
   if (speed > 40.0) { // More than 40 m/s (~90 mph) is suspicious
     isAnomaly = true;
-    suspiciousCount[nodeId]++;
+    state.suspiciousCount++;
   }
-  
+
   // Check if position changed too much since last reading
-  if (!mobilityHistory[nodeId].empty() && mobilityHistory[nodeId].size() >= 4) {
+  if (!state.mobilityHistory.empty() && state.mobilityHistory.size() >= 4) {
     // Compare current and previous positions
     // This is a simplified check
     if (speed > 35.0) { // High speed movement
       isAnomaly = true;
-      suspiciousCount[nodeId]++;
+      state.suspiciousCount++;
     }
   }
-  
+
   // Store current position for future comparisons
-  mobilityHistory[nodeId] = {pos.x, pos.y, vel.x, vel.y};
-  
-  return isAnomaly;
-}
+  state.mobilityHistory = {pos.x, pos.y, vel.x, vel.y};
 
-void RunMLDetection(NodeContainer nodes)
-{
-  for (uint32_t i = 0; i < nodes.GetN(); i++)
-  {
-    Ptr<MobilityModel> mob = nodes.Get(i)->GetObject<MobilityModel>();
-    Vector pos = mob->GetPosition();
-    Vector vel = mob->GetVelocity();
-    
-    bool isAnomaly = detectAnomaly(i, pos, vel);
-    
-    if (isAnomaly) {
-      ml_output << Simulator::Now().GetSeconds() 
-               << "," << i 
-               << ",anomaly_detected," << suspiciousCount[i] 
-               << "\n";
-    }
-  }
-  
-  Simulator::Schedule(Seconds(0.5), &RunMLDetection, nodes);
+  return isAnomaly;
 }
 
 // -------------------------
 // Rule-based Detection
 // -------------------------
-bool checkRuleBased(uint32_t nodeId)
+bool checkRuleBased(uint32_t nodeId, Time now)
 {
   // Rule 1: Check packet frequency
   // If a node sends too many packets in a short time window, flag as suspicious
-  Time now = Simulator::Now();
-  std::vector<Time>& timestamps = packetTimestamps[nodeId];
-  
+  std::vector<Time>& timestamps = nodeState[nodeId].packetTimestamps;
+
   // Keep only recent timestamps (last 0.5 seconds)
   auto it = timestamps.begin();
   while (it != timestamps.end()) {
@@ -353,66 +1347,474 @@ bool checkRuleBased(uint32_t nodeId)
       ++it;
     }
   }
-  
+
   // If more than 15 packets in 0.5 seconds, likely DDoS
   if (timestamps.size() > 15) {
     return true; // Suspicious
   }
-  
-  return false; // Not suspicious
+
+  return false; // Not suspicious
+}
+
+// -------------------------
+// Detector Graph
+// -------------------------
+// All periodic detectors are driven from a single detection tick. A detector
+// produces at most one verdict per node per epoch (tick). Composite detectors
+// (hybrid) consume the cached verdicts of the base detectors they depend on
+// instead of re-running them, so side effects such as suspicious counts and
+// timestamp pruning happen once per epoch regardless of which sweeps are due.
+struct DetectorSpec {
+  const char* name;
+  uint32_t startTick;            // First tick of the detector's own sweep
+  uint32_t periodTicks;          // Sweep period in ticks
+  bool* enabled;                 // Whether the sweep runs (and logs)
+  bool needsSnapshot;            // Reads the tick kinematics snapshot
+  std::vector<DetectorId> deps;  // Verdicts needed from the same epoch
+};
+
+static const double g_detectionTick = 0.1;  // Epoch length (s)
+
+// Trust is consumed by hybrid as its latest published score (it is a slow,
+// history-averaged signal), ML and rule verdicts are needed fresh.
+std::vector<DetectorSpec> detectorGraph = {
+  {"trust",  10, 10, &g_enable_trust,  true,  {}},
+  {"ml",     10,  5, &g_enable_ml,     true,  {}},
+  {"rule",    5,  1, &g_enable_rule,   false, {}},
+  {"hybrid", 15,  2, &g_enable_hybrid, true,  {DET_ML, DET_RULE}},
+};
+
+bool IsDetectorDue(DetectorId id, uint64_t tick)
+{
+  const DetectorSpec& spec = detectorGraph[id];
+  return *spec.enabled && tick >= spec.startTick && (tick - spec.startTick) % spec.periodTicks == 0;
+}
+
+// Memoized per-node evaluation; only touches the node's own slot
+bool EvaluateDetector(DetectorId id, uint32_t i, uint64_t epoch, Time now)
+{
+  NodeDetectorState& state = nodeState[i];
+  if (state.verdictEpoch[id] == epoch + 1) {
+    return state.verdict[id];
+  }
+  for (DetectorId dep : detectorGraph[id].deps) {
+    EvaluateDetector(dep, i, epoch, now);
+  }
+
+  bool verdict = false;
+  switch (id)
+  {
+    case DET_TRUST:
+      state.trust = calculateTrustScore(i, tickSnapshot[i].pos, tickSnapshot[i].vel, now);
+      state.score[id] = state.trust;
+      verdict = state.trust < 0.5;
+      break;
+    case DET_ML:
+      state.score[id] = sqrt(tickSnapshot[i].vel.x * tickSnapshot[i].vel.x +
+                             tickSnapshot[i].vel.y * tickSnapshot[i].vel.y);  // Speed
+      verdict = detectAnomaly(i, tickSnapshot[i].pos, tickSnapshot[i].vel);
+      break;
+    case DET_RULE:
+      verdict = checkRuleBased(i, now);
+      state.score[id] = state.packetTimestamps.size();  // Packets in the window
+      break;
+    case DET_HYBRID:
+      // Hybrid detection: flag if any method detects an issue AND trust is low
+      verdict = (state.verdict[DET_ML] || state.verdict[DET_RULE]) && state.trust < 0.6;
+      state.score[id] = (state.verdict[DET_ML] || state.verdict[DET_RULE])
+                            ? state.trust : std::numeric_limits<double>::infinity();
+      break;
+    default:
+      break;
+  }
+
+  state.verdictEpoch[id] = epoch + 1;
+  state.verdict[id] = verdict;
+  return verdict;
+}
+
+void LogVerdict(DetectorId id, uint32_t i, Time now)
+{
+  const NodeDetectorState& state = nodeState[i];
+  switch (id)
+  {
+    case DET_TRUST:
+      trust_output << now.GetSeconds()
+                  << "," << i
+                  << "," << state.trust
+                  << "," << (state.verdict[DET_TRUST] ? 1 : 0)  // Flag if low trust
+                  << "\n";
+      break;
+    case DET_ML:
+      if (state.verdict[DET_ML]) {
+        ml_output << now.GetSeconds()
+                 << "," << i
+                 << ",anomaly_detected," << state.suspiciousCount
+                 << "\n";
+      }
+      break;
+    case DET_RULE:
+      if (state.verdict[DET_RULE]) {
+        mitigation_output << now.GetSeconds()
+                        << "," << i
+                        << ",rule_based_detection,high_frequency"
+                        << "\n";
+      }
+      break;
+    case DET_HYBRID:
+      if (state.verdict[DET_HYBRID]) {
+        mitigation_output << now.GetSeconds()
+                        << "," << i
+                        << ",hybrid_detection,ml_anomaly=" << state.verdict[DET_ML]
+                        << ",rule_violation=" << state.verdict[DET_RULE]
+                        << ",trust_score=" << state.trust
+                        << "\n";
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// -------------------------
+// Detector Evaluation (ROC)
+// -------------------------
+// With --evaluate every (node, epoch) score a detector produces is binned
+// against a sorted threshold vector as it is computed; prefix sums at exit
+// give the confusion matrix at every threshold, so one run yields the whole
+// ROC/PR table per detector instead of one run per operating point. A score
+// is positive when its node is inside an attack interval at that epoch.
+static bool g_evaluate = false;
+static std::string g_thresholds[DET_COUNT] = {"", "", "", ""};  // Comma separated, empty: default sweep
+static std::ofstream roc_output;
+
+// Role a vehicle plays for the whole run
+std::string AttackerRole(uint32_t nodeId)
+{
+  if (g_enable_ddos && nodeId == 5) return "ddos";
+  if (g_enable_sybil && nodeId == 10) return "sybil";
+  if (g_enable_replay && nodeId == 15) return "replay";
+  if (g_enable_msg_falsification && nodeId == 20) return "falsification";
+  if (g_enable_jamming && nodeId == 25) return "jamming";
+  return "none";
+}
+
+struct DetectorRoc {
+  std::vector<double> thresholds;  // Ascending
+  bool flagBelow = false;          // Flags score < threshold, else score > threshold
+  std::vector<uint64_t> positives; // Score histogram over the threshold bins
+  std::vector<uint64_t> negatives;
+};
+std::vector<DetectorRoc> detectorRoc(DET_COUNT);
+
+std::vector<double> ParseThresholds(const std::string& list, double lo, double hi, double step)
+{
+  std::vector<double> thresholds;
+  if (list.empty()) {
+    for (double t = lo; t <= hi + step / 2; t += step) {
+      thresholds.push_back(t);
+    }
+    return thresholds;
+  }
+  const char* p = list.c_str();
+  char* end;
+  while (*p) {
+    double t = std::strtod(p, &end);
+    if (end == p) break;
+    thresholds.push_back(t);
+    p = (*end == ',') ? end + 1 : end;
+  }
+  std::sort(thresholds.begin(), thresholds.end());
+  return thresholds;
+}
+
+// Default sweeps bracket the in-simulation operating points
+// (trust < 0.5, speed > 40, packets > 15, hybrid trust < 0.6)
+void SetupDetectorRoc()
+{
+  detectorRoc[DET_TRUST].thresholds = ParseThresholds(g_thresholds[DET_TRUST], 0.0, 1.0, 0.05);
+  detectorRoc[DET_TRUST].flagBelow = true;
+  detectorRoc[DET_ML].thresholds = ParseThresholds(g_thresholds[DET_ML], 0.0, 60.0, 2.5);
+  detectorRoc[DET_RULE].thresholds = ParseThresholds(g_thresholds[DET_RULE], 0.0, 40.0, 1.0);
+  detectorRoc[DET_HYBRID].thresholds = ParseThresholds(g_thresholds[DET_HYBRID], 0.0, 1.0, 0.05);
+  detectorRoc[DET_HYBRID].flagBelow = true;
+
+  for (DetectorRoc& roc : detectorRoc) {
+    roc.positives.assign(roc.thresholds.size() + 1, 0);
+    roc.negatives.assign(roc.thresholds.size() + 1, 0);
+  }
+}
+
+void AccumulateRoc(DetectorId id, uint32_t i, Time now)
+{
+  DetectorRoc& roc = detectorRoc[id];
+  double score = nodeState[i].score[id];
+  // Bin b: flagged at threshold k iff k >= b (below) or k < b (above)
+  size_t bin = roc.flagBelow
+      ? std::upper_bound(roc.thresholds.begin(), roc.thresholds.end(), score) - roc.thresholds.begin()
+      : std::lower_bound(roc.thresholds.begin(), roc.thresholds.end(), score) - roc.thresholds.begin();
+  if (IsAttackLabeled(i, now.GetSeconds())) {
+    roc.positives[bin]++;
+  } else {
+    roc.negatives[bin]++;
+  }
+}
+
+void WriteRocTables()
+{
+  roc_output.open(LogFileName("roc_log.csv"));
+  roc_output << "detector,threshold,tp,fp,tn,fn,tpr,fpr,precision" << "\n";
+
+  for (uint32_t id = 0; id < DET_COUNT; id++) {
+    const DetectorRoc& roc = detectorRoc[id];
+    size_t n = roc.thresholds.size();
+    uint64_t totalPos = std::accumulate(roc.positives.begin(), roc.positives.end(), (uint64_t)0);
+    uint64_t totalNeg = std::accumulate(roc.negatives.begin(), roc.negatives.end(), (uint64_t)0);
+
+    // Flagged counts per threshold: prefix sums (below) or suffix sums (above)
+    std::vector<uint64_t> tp(n, 0), fp(n, 0);
+    if (roc.flagBelow) {
+      uint64_t p = 0, f = 0;
+      for (size_t k = 0; k < n; k++) {
+        p += roc.positives[k];
+        f += roc.negatives[k];
+        tp[k] = p;
+        fp[k] = f;
+      }
+    } else {
+      uint64_t p = 0, f = 0;
+      for (size_t k = n; k-- > 0;) {
+        p += roc.positives[k + 1];
+        f += roc.negatives[k + 1];
+        tp[k] = p;
+        fp[k] = f;
+      }
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      roc_output << detectorGraph[id].name
+                 << "," << roc.thresholds[k]
+                 << "," << tp[k]
+                 << "," << fp[k]
+                 << "," << (totalNeg - fp[k])
+                 << "," << (totalPos - tp[k])
+                 << "," << (totalPos ? (double)tp[k] / totalPos : 0.0)
+                 << "," << (totalNeg ? (double)fp[k] / totalNeg : 0.0)
+                 << "," << (tp[k] + fp[k] ? (double)tp[k] / (tp[k] + fp[k]) : 1.0)
+                 << "\n";
+    }
+  }
+  roc_output.close();
+}
+
+// Evaluates the detectors due at this tick on tickSnapshot and logs them.
+// Independent of the simulator so the replay mode can drive it as well.
+void DetectionTick(uint64_t tick, Time now, uint32_t numNodes)
+{
+  std::vector<DetectorId> due;
+  for (uint32_t id = 0; id < DET_COUNT; id++) {
+    if (IsDetectorDue((DetectorId)id, tick)) {
+      due.push_back((DetectorId)id);
+    }
+  }
+  if (due.empty()) return;
+
+  sweepPool.Run(numNodes, [&due, tick, now](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++)
+    {
+      if (!IsLocalNode(i)) continue;
+      for (DetectorId id : due) {
+        EvaluateDetector(id, i, tick, now);
+      }
+    }
+  });
+
+  for (DetectorId id : due) {
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+      if (!IsLocalNode(i)) continue;
+      LogVerdict(id, i, now);
+      if (g_evaluate) {
+        AccumulateRoc(id, i, now);
+      }
+    }
+  }
+}
+
+// -------------------------
+// Detector Inputs
+// -------------------------
+// Everything the detectors consume goes through two entry points:
+// OnBsmReception() for every BSM a vehicle hears and DetectionTick() with the
+// tick snapshot. Live runs feed them from ReceivePacket and the detection
+// tick; with --recordFile the same inputs are written to a binary stream that
+// the replay mode (--replayFile) feeds back without re-simulating.
+struct BsmReception {
+  Time rxTime;
+  uint32_t receiverId = 0;
+  uint32_t senderId = 0;   // Claimed identity
+  double posX = 0, posY = 0;
+  double velX = 0, velY = 0;
+  double txTime = 0;       // Timestamp claimed in the BSM
+  double rssi = -1.0;
+  uint32_t size = 0;
+};
+
+// "BSM,id,x,y,vx,vy,t"; only the identity is mandatory
+bool ParseBsm(const std::string& s, BsmReception& rx)
+{
+  size_t pos1 = s.find(',');
+  if (pos1 == std::string::npos) return false;
+  size_t pos2 = s.find(',', pos1 + 1);
+  if (pos2 == std::string::npos) return false;
+
+  const char* p = s.c_str() + pos1 + 1;
+  char* end;
+  rx.senderId = std::strtoul(p, &end, 10);
+  if (end == p) return false;
+
+  double* fields[] = {&rx.posX, &rx.posY, &rx.velX, &rx.velY, &rx.txTime};
+  p = s.c_str() + pos2;
+  for (double* field : fields) {
+    if (*p != ',') break;
+    *field = std::strtod(p + 1, &end);
+    p = end;
+  }
+  return true;
+}
+
+void OnBsmReception(const BsmReception& rx)
+{
+  uint32_t nodeId = rx.senderId;
+
+  // Update packet frequency for rule-based detection
+  if (nodeId < nodeState.size()) {
+    nodeState[nodeId].packetTimestamps.push_back(rx.rxTime);
+  } else {
+    packetTimestamps[nodeId].push_back(rx.rxTime);
+  }
+  packetFreqCount[nodeId]++;
+}
+
+// Binary stream: header, then tagged reception and tick records.
+// Times are stored as simulator time steps so replays are exact.
+static std::string g_recordFile = "";
+static std::ofstream record_output;
+static const char g_recordMagic[8] = {'V', 'A', 'N', 'E', 'T', 'R', 'E', 'C'};
+static const uint32_t g_recordVersion = 1;
+enum RecordType : uint8_t { REC_RECEPTION = 1, REC_TICK = 2 };
+
+template <typename T>
+void WriteRaw(std::ofstream& out, const T& value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool ReadRaw(std::istream& in, T& value)
+{
+  return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+void RecordHeader(uint32_t numVehicles)
+{
+  record_output.write(g_recordMagic, sizeof(g_recordMagic));
+  WriteRaw(record_output, g_recordVersion);
+  WriteRaw(record_output, numVehicles);
+}
+
+void RecordReception(const BsmReception& rx)
+{
+  WriteRaw(record_output, REC_RECEPTION);
+  WriteRaw(record_output, (int64_t)rx.rxTime.GetTimeStep());
+  WriteRaw(record_output, rx.receiverId);
+  WriteRaw(record_output, rx.senderId);
+  WriteRaw(record_output, rx.posX);
+  WriteRaw(record_output, rx.posY);
+  WriteRaw(record_output, rx.velX);
+  WriteRaw(record_output, rx.velY);
+  WriteRaw(record_output, rx.txTime);
+  WriteRaw(record_output, rx.rssi);
+  WriteRaw(record_output, rx.size);
+}
+
+void RecordTick(uint64_t tick, Time now, bool withSnapshot)
+{
+  uint32_t count = withSnapshot ? tickSnapshot.size() : 0;
+  WriteRaw(record_output, REC_TICK);
+  WriteRaw(record_output, tick);
+  WriteRaw(record_output, (int64_t)now.GetTimeStep());
+  WriteRaw(record_output, count);
+  for (uint32_t i = 0; i < count; i++) {
+    WriteRaw(record_output, tickSnapshot[i].pos.x);
+    WriteRaw(record_output, tickSnapshot[i].pos.y);
+    WriteRaw(record_output, tickSnapshot[i].vel.x);
+    WriteRaw(record_output, tickSnapshot[i].vel.y);
+  }
+}
+
+// A recording keeps the snapshot of every tick on which any kinematic
+// detector could run, so replays may enable detectors the live run had off.
+bool TickNeedsSnapshot(uint64_t tick, bool ignoreEnabled)
+{
+  for (uint32_t id = 0; id < DET_COUNT; id++) {
+    const DetectorSpec& spec = detectorGraph[id];
+    if (spec.needsSnapshot && (ignoreEnabled || *spec.enabled) &&
+        tick >= spec.startTick && (tick - spec.startTick) % spec.periodTicks == 0) {
+      return true;
+    }
+  }
+  return false;
 }
 
-void UpdateRuleBasedDetection(NodeContainer nodes)
+void RunDetectionTick(NodeContainer nodes, uint64_t tick)
 {
-  for (uint32_t i = 0; i < nodes.GetN(); i++)
-  {
-    bool isSuspicious = checkRuleBased(i);
-    
-    if (isSuspicious) {
-      // Log rule-based detection
-      // We'll track this in the mitigation log
-      mitigation_output << Simulator::Now().GetSeconds()
-                      << "," << i
-                      << ",rule_based_detection,high_frequency"
-                      << "\n";
-    }
+  Time now = Simulator::Now();
+  bool recording = record_output.is_open();
+
+  bool snapshot = TickNeedsSnapshot(tick, recording);
+  if (snapshot) {
+    TakeTickSnapshot(nodes);
   }
-  
-  Simulator::Schedule(Seconds(0.1), &UpdateRuleBasedDetection, nodes);
+  if (recording) {
+    RecordTick(tick, now, snapshot);
+  }
+
+  DetectionTick(tick, now, nodes.GetN());
+
+  Simulator::Schedule(Seconds(g_detectionTick), &RunDetectionTick, nodes, tick + 1);
 }
 
 // -------------------------
-// Hybrid Detection (Combining multiple approaches)
+// RSSI Receiver Callback with Attack Detection
 // -------------------------
-void RunHybridDetection(NodeContainer nodes)
+// Processing of one BSM heard by a vehicle owned by this rank
+void ProcessBsm(Ptr<Node> node, Ptr<Packet> packet)
 {
-  for (uint32_t i = 0; i < nodes.GetN(); i++)
-  {
-    Ptr<MobilityModel> mob = nodes.Get(i)->GetObject<MobilityModel>();
-    Vector pos = mob->GetPosition();
-    Vector vel = mob->GetVelocity();
-    
-    bool mlAnomaly = detectAnomaly(i, pos, vel);
-    bool ruleSuspicious = checkRuleBased(i);
-    double trustScore = nodeTrust[i];
-    
-    // Hybrid detection: flag if any method detects an issue AND trust is low
-    if ((mlAnomaly || ruleSuspicious) && trustScore < 0.6) {
-      mitigation_output << Simulator::Now().GetSeconds()
-                      << "," << i
-                      << ",hybrid_detection,ml_anomaly=" << mlAnomaly 
-                      << ",rule_violation=" << ruleSuspicious
-                      << ",trust_score=" << trustScore
-                      << "\n";
+  uint8_t buf[200];
+  packet->CopyData(buf, packet->GetSize());
+  std::string s((char*)buf, packet->GetSize());
+
+  BsmReception rx;
+  rx.rxTime = Simulator::Now();
+  rx.receiverId = node->GetId();
+  rx.size = packet->GetSize();
+  rx.rssi = -1.0; // Placeholder - actual RSSI requires detailed channel model
+
+  // Parse the received BSM for analysis
+  if (ParseBsm(s, rx)) {
+    if (record_output.is_open()) {
+      RecordReception(rx);
     }
+    OnBsmReception(rx);
+  }
+
+  // Log RSSI information
+  if (g_logRssi) {
+    rssi_output << rx.rxTime.GetSeconds() << "," << node->GetId() << "," << s << "," << rx.rssi << "\n";
   }
-  
-  Simulator::Schedule(Seconds(0.2), &RunHybridDetection, nodes);
 }
 
-// -------------------------
-// RSSI Receiver Callback with Attack Detection
-// -------------------------
 void ReceivePacket(Ptr<Socket> socket)
 {
   Ptr<Node> node = socket->GetNode();
@@ -421,50 +1823,72 @@ void ReceivePacket(Ptr<Socket> socket)
 
   while ((packet = socket->RecvFrom(src)))
   {
-    uint8_t buf[200];
-    packet->CopyData(buf, packet->GetSize());
-    std::string s((char*)buf, packet->GetSize());
-
-    // Parse the received BSM for analysis
-    size_t pos1 = s.find(',');
-    size_t pos2 = s.find(',', pos1 + 1);
-    if (pos1 != std::string::npos && pos2 != std::string::npos) {
-      std::string msgType = s.substr(0, pos1);
-      std::string nodeIdStr = s.substr(pos1 + 1, pos2 - pos1 - 1);
-      uint32_t nodeId = std::stoi(nodeIdStr);
-      
-      // Update packet frequency for rule-based detection
-      packetTimestamps[nodeId].push_back(Simulator::Now());
-      packetFreqCount[nodeId]++;
+#ifdef NS3_MPI
+    if (!IsLocalNode(node->GetId())) {
+      // Heard by this rank's copy of a vehicle owned elsewhere: hand the
+      // reception to the owner, which cannot be behind now + lookahead.
+      MpiInterface::SendPacket(packet, Simulator::Now() + CrossRankLookahead(),
+                               node->GetId(), node->GetDevice(0)->GetIfIndex());
+      continue;
     }
+#endif
+    ProcessBsm(node, packet);
+  }
+}
 
-    // Log RSSI information (placeholder)
-    double rssi = -1.0; // Placeholder - actual RSSI requires detailed channel model
-    rssi_output << node->GetId() << "," << s << "," << rssi << "\n";
+// Raw BSM frame (--wsmp), same handling as ReceivePacket
+void ReceiveWsmp(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                 const Address& from, const Address& to, NetDevice::PacketType packetType)
+{
+  Ptr<Node> node = device->GetNode();
+#ifdef NS3_MPI
+  if (!IsLocalNode(node->GetId())) {
+    MpiInterface::SendPacket(packet->Copy(), Simulator::Now() + CrossRankLookahead(),
+                             node->GetId(), device->GetIfIndex());
+    return;
   }
+#endif
+  ProcessBsm(node, packet->Copy());
+}
+
+#ifdef NS3_MPI
+// Reception forwarded by the rank that owns the transmitter
+void ReceiveForwardedBsm(Ptr<Node> node, Ptr<Packet> packet)
+{
+  ProcessBsm(node, packet);
 }
+#endif
 
 // -------------------------
 // Neighbor Count (heuristic)
 // -------------------------
 void LogNeighbors(NodeContainer nodes)
 {
-  for (uint32_t i = 0; i < nodes.GetN(); i++)
-  {
-    Ptr<MobilityModel> mob_i = nodes.Get(i)->GetObject<MobilityModel>();
-    Vector pos_i = mob_i->GetPosition();
+  uint32_t n = nodes.GetN();
+  TakeTickSnapshot(nodes);
 
-    uint32_t count = 0;
-
-    for (uint32_t j = 0; j < nodes.GetN(); j++)
+  sweepPool.Run(n, [n](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++)
     {
-      if (i == j) continue;
-      Ptr<MobilityModel> mob_j = nodes.Get(j)->GetObject<MobilityModel>();
-      if (mob_i->GetDistanceFrom(mob_j) < 250.0)  // Communication range approx
-        count++;
+      if (!IsLocalNode(i)) continue;
+
+      Vector pos_i = tickSnapshot[i].pos;
+      uint32_t count = 0;
+
+      for (uint32_t j = 0; j < n; j++)
+      {
+        if (i == j) continue;
+        if (CalculateDistance(pos_i, tickSnapshot[j].pos) < g_commRange)
+          count++;
+      }
+      nodeState[i].neighborCount = count;
     }
+  });
 
-    neighbor_output << Simulator::Now().GetSeconds() << "," << i << "," << count << "\n";
+  for (uint32_t i = 0; i < n; i++)
+  {
+    if (!IsLocalNode(i)) continue;
+    neighbor_output << Simulator::Now().GetSeconds() << "," << i << "," << nodeState[i].neighborCount << "\n";
   }
 
   Simulator::Schedule(Seconds(0.2), &LogNeighbors, nodes);
@@ -509,9 +1933,16 @@ void InjectJammerNode(Ptr<Socket> sock, uint32_t nodeId)
 {
   if (g_enable_jamming) {
     jammerNodes.insert(nodeId);
+    BeginAttackLabel(nodeId, nodeId, "jamming");
     std::string j = "JAMMING_SIGNAL";
     Ptr<Packet> p = Create<Packet>((const uint8_t*)j.c_str(), j.length());
-    sock->Send(p);
+    if (g_abstractChannel) {
+      abstractChannel.Broadcast(nodeId, p, false);
+    } else if (g_wsmp) {
+      SendRaw(NodeList::GetNode(nodeId), p, g_jamEtherType);
+    } else {
+      sock->Send(p);
+    }
 
     jammer_output << Simulator::Now().GetSeconds() << "," << nodeId << ",jamming_active\n";
 
@@ -530,6 +1961,492 @@ void InjectMsgFalsification(NodeContainer nodes, uint32_t attacker)
   Simulator::Schedule(Seconds(12.0), &InjectMsgFalsification, nodes, attacker);
 }
 
+// -------------------------
+// Attack Scheduling
+// -------------------------
+// Offsets are absolute simulation times; attacks armed later (branch mode)
+// start their injections immediately if those times have already passed.
+Time AttackDelay(double at)
+{
+  return Seconds(std::max(0.0, at - Simulator::Now().GetSeconds()));
+}
+
+void ScheduleAttacks(NodeContainer vehicles)
+{
+  // Start attack injection (after simulation starts)
+  if (g_enable_ddos && IsLocalNode(5)) {
+    Simulator::Schedule(AttackDelay(3.0), &InjectDdosAttack, vehicles, 5);
+  }
+  if (g_enable_sybil && IsLocalNode(10)) {
+    Simulator::Schedule(AttackDelay(4.0), &InjectSybilAttack, vehicles, 10);
+  }
+  if (g_enable_replay && IsLocalNode(15)) {
+    Simulator::Schedule(AttackDelay(6.0), &InjectReplayAttack, vehicles, 15);
+  }
+  if (g_enable_msg_falsification && IsLocalNode(20)) {
+    Simulator::Schedule(AttackDelay(8.0), &InjectMsgFalsification, vehicles, 20);
+  }
+
+  // Jammer node = node 25
+  if (g_enable_jamming && IsLocalNode(25)) {
+    Ptr<Socket> jsock;
+    if (!g_abstractChannel && !g_wsmp) {
+      Ptr<Node> jnode = vehicles.Get(25);
+      jsock = Socket::CreateSocket(jnode, UdpSocketFactory::GetTypeId());
+      jsock->SetAllowBroadcast(true);
+      jsock->Connect(InetSocketAddress(Ipv4Address("255.255.255.255"), 5001));
+    }
+    Simulator::Schedule(AttackDelay(2.0), &InjectJammerNode, jsock, 25);
+  }
+}
+
+// -------------------------
+// Branching (fork at a warmed-up state)
+// -------------------------
+// With --branches the benign prefix (mobility, association, beaconing) is
+// simulated once with all attacks disabled. At --branchTime the process
+// forks once per branch; each child applies its flag overrides on top of the
+// command line, arms the attacks and continues into its own output
+// directory, sharing the warmed-up state copy-on-write. The parent waits.
+//   --branches="ddos:enable_ddos=1;sybil:enable_sybil=1,enable_trust=0"
+static std::string g_branches = "";
+static double g_branchTime = 3.0;
+
+struct BranchFlag {
+  const char* name;
+  bool* value;
+};
+static const BranchFlag g_branchFlags[] = {
+  {"enable_ddos", &g_enable_ddos},
+  {"enable_sybil", &g_enable_sybil},
+  {"enable_replay", &g_enable_replay},
+  {"enable_jamming", &g_enable_jamming},
+  {"enable_msg_falsification", &g_enable_msg_falsification},
+  {"enable_trust", &g_enable_trust},
+  {"enable_ml", &g_enable_ml},
+  {"enable_hybrid", &g_enable_hybrid},
+  {"enable_rule", &g_enable_rule},
+};
+static const uint32_t g_numAttackFlags = 5;  // First entries of g_branchFlags
+
+struct Branch {
+  std::string name;
+  std::vector<std::pair<bool*, bool>> overrides;
+};
+std::vector<Branch> branches;
+bool g_attackFlags[g_numAttackFlags];  // Command-line attack flags, held back during the prefix
+std::vector<pid_t> branchPids;
+
+// Logs that follow a run into its branch directory
+static const std::pair<std::ofstream*, const char*> g_branchLogs[] = {
+  {&bsm_output, "bsm_log.csv"},
+  {&attack_output, "attack_log.csv"},
+  {&mitigation_output, "mitigation_log.csv"},
+  {&trust_output, "trust_log.csv"},
+  {&ml_output, "ml_detection_log.csv"},
+  {&neighbor_output, "neighbor_log.csv"},
+  {&jammer_output, "jammer_log.csv"},
+  {&sybil_output, "sybil_log.csv"},
+  {&ddos_output, "ddos_log.csv"},
+  {&msg_falsification_output, "msg_falsification_log.csv"},
+  {&rssi_output, "rssi_log.csv"},
+};
+
+void ParseBranches(const std::string& spec)
+{
+  std::istringstream in(spec);
+  std::string item;
+  while (std::getline(in, item, ';')) {
+    if (item.empty()) continue;
+    Branch branch;
+    size_t colon = item.find(':');
+    branch.name = item.substr(0, colon);
+    std::istringstream overrides(colon == std::string::npos ? "" : item.substr(colon + 1));
+    std::string assignment;
+    while (std::getline(overrides, assignment, ',')) {
+      size_t eq = assignment.find('=');
+      std::string flag = assignment.substr(0, eq);
+      std::string value = eq == std::string::npos ? "1" : assignment.substr(eq + 1);
+      bool* target = nullptr;
+      for (const BranchFlag& f : g_branchFlags) {
+        if (flag == f.name) target = f.value;
+      }
+      if (!target) {
+        NS_FATAL_ERROR("Unknown flag '" << flag << "' in branch " << branch.name);
+      }
+      branch.overrides.push_back({target, value == "1" || value == "true"});
+    }
+    branches.push_back(branch);
+  }
+}
+
+// Called before the network is built: the prefix runs without attacks
+void HoldBackAttacks()
+{
+  for (uint32_t k = 0; k < g_numAttackFlags; k++) {
+    g_attackFlags[k] = *g_branchFlags[k].value;
+    *g_branchFlags[k].value = false;
+  }
+}
+
+// Moves the open logs into the branch directory, keeping the prefix rows
+void RedirectLogs(const std::string& dir)
+{
+  std::vector<std::string> prefixFiles;
+  for (const auto& log : g_branchLogs) {
+    prefixFiles.push_back(LogFileName(log.second));
+    log.first->close();
+  }
+  std::string recordPrefix = LogFileName(g_recordFile);
+  bool recording = record_output.is_open();
+  record_output.close();
+
+  g_outputDir = dir + "/";
+  std::filesystem::create_directories(dir);
+  for (size_t k = 0; k < prefixFiles.size(); k++) {
+    const auto& log = g_branchLogs[k];
+    if (std::filesystem::exists(prefixFiles[k])) {
+      std::filesystem::copy_file(prefixFiles[k], LogFileName(log.second),
+                                 std::filesystem::copy_options::overwrite_existing);
+      log.first->open(LogFileName(log.second), std::ios::app);
+    }
+  }
+  if (recording) {
+    std::filesystem::copy_file(recordPrefix, LogFileName(g_recordFile),
+                               std::filesystem::copy_options::overwrite_existing);
+    record_output.open(LogFileName(g_recordFile), std::ios::binary | std::ios::app);
+  }
+}
+
+void EnterBranch(const Branch& branch, NodeContainer vehicles)
+{
+  for (uint32_t k = 0; k < g_numAttackFlags; k++) {
+    *g_branchFlags[k].value = g_attackFlags[k];
+  }
+  for (const auto& o : branch.overrides) {
+    *o.first = o.second;
+  }
+  RedirectLogs(branch.name);
+
+  // Arm the attacker apps for this branch
+  for (uint32_t i = 0; i < vehicles.GetN(); i++) {
+    if (!IsLocalNode(i)) continue;
+    Ptr<EnhancedBsmApp> app = DynamicCast<EnhancedBsmApp>(vehicles.Get(i)->GetApplication(0));
+    std::string attackType = AttackerRole(i);
+    app->SetAttack(attackType, attackType != "none" && attackType != "jamming");
+  }
+  ScheduleAttacks(vehicles);
+}
+
+void ForkBranches(NodeContainer vehicles)
+{
+  // Worker threads do not survive fork() and buffered rows would be
+  // written twice, so quiesce both before forking.
+  sweepPool.Stop();
+  for (const auto& log : g_branchLogs) {
+    log.first->flush();
+  }
+  record_output.flush();
+  std::cout.flush();
+
+  for (const Branch& branch : branches) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      NS_FATAL_ERROR("fork() failed for branch " << branch.name);
+    }
+    if (pid == 0) {
+      branchPids.clear();
+      sweepPool.Start(g_detectorThreads);
+      EnterBranch(branch, vehicles);
+      return;
+    }
+    branchPids.push_back(pid);
+  }
+
+  // The parent only owns the prefix
+  Simulator::Stop();
+}
+
+// Returns non-zero if any branch failed
+int WaitForBranches()
+{
+  int failed = 0;
+  for (size_t k = 0; k < branchPids.size(); k++) {
+    int status = 0;
+    waitpid(branchPids[k], &status, 0);
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    std::cout << "Branch " << branches[k].name << (ok ? " finished" : " FAILED") << std::endl;
+    failed += ok ? 0 : 1;
+  }
+  return failed ? 1 : 0;
+}
+
+// -------------------------
+// Offline Detector Replay
+// -------------------------
+// --replayFile re-runs the detectors on a recorded input stream without
+// building nodes, channel or apps. Accepted inputs are the binary stream
+// written with --recordFile and the rssi_log.csv written with --rssiLog.
+struct ReplayRecord {
+  RecordType type = REC_RECEPTION;
+  BsmReception rx;
+  uint64_t tick = 0;
+  Time now;
+  std::vector<NodeSnapshot> snapshot;  // Empty: keep the previous snapshot
+};
+
+class ReplaySource {
+public:
+  virtual ~ReplaySource() {}
+  virtual bool Next(ReplayRecord& rec) = 0;
+};
+
+class BinaryReplaySource : public ReplaySource {
+public:
+  explicit BinaryReplaySource(const std::string& file) : m_in(file, std::ios::binary) {}
+
+  // Validates the header and returns the fleet size of the recording
+  bool Open(uint32_t& numVehicles)
+  {
+    char magic[sizeof(g_recordMagic)];
+    uint32_t version = 0;
+    if (!m_in.read(magic, sizeof(magic)) || std::memcmp(magic, g_recordMagic, sizeof(magic)) != 0) {
+      return false;
+    }
+    return ReadRaw(m_in, version) && version == g_recordVersion && ReadRaw(m_in, numVehicles);
+  }
+
+  bool Next(ReplayRecord& rec) override
+  {
+    uint8_t type;
+    int64_t step;
+    if (!ReadRaw(m_in, type)) return false;
+    rec.type = (RecordType)type;
+
+    if (rec.type == REC_RECEPTION) {
+      BsmReception& rx = rec.rx;
+      bool ok = ReadRaw(m_in, step) && ReadRaw(m_in, rx.receiverId) && ReadRaw(m_in, rx.senderId) &&
+                ReadRaw(m_in, rx.posX) && ReadRaw(m_in, rx.posY) && ReadRaw(m_in, rx.velX) &&
+                ReadRaw(m_in, rx.velY) && ReadRaw(m_in, rx.txTime) && ReadRaw(m_in, rx.rssi) &&
+                ReadRaw(m_in, rx.size);
+      rx.rxTime = TimeStep(step);
+      return ok;
+    }
+
+    uint32_t count = 0;
+    if (rec.type != REC_TICK || !ReadRaw(m_in, rec.tick) || !ReadRaw(m_in, step) || !ReadRaw(m_in, count)) {
+      return false;
+    }
+    rec.now = TimeStep(step);
+    rec.snapshot.resize(count);
+    for (NodeSnapshot& n : rec.snapshot) {
+      if (!ReadRaw(m_in, n.pos.x) || !ReadRaw(m_in, n.pos.y) ||
+          !ReadRaw(m_in, n.vel.x) || !ReadRaw(m_in, n.vel.y)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::ifstream m_in;
+};
+
+// rssi_log.csv carries receptions only. Detection ticks are synthesized on
+// the regular tick grid and their snapshot is the last kinematics each
+// vehicle claimed, which is what a receiver-side detector can know (a
+// recording holds the true positions instead).
+class RssiCsvReplaySource : public ReplaySource {
+public:
+  RssiCsvReplaySource(const std::string& file, uint32_t numVehicles)
+    : m_in(file), m_claimed(numVehicles) {}
+
+  bool Next(ReplayRecord& rec) override
+  {
+    if (!m_pendingValid && !ReadReception(m_pending)) {
+      return false;
+    }
+    m_pendingValid = true;
+
+    // Ticks up to and including the reception time come first
+    Time tickTime = Seconds(m_nextTick * g_detectionTick);
+    if (tickTime <= m_pending.rxTime) {
+      rec.type = REC_TICK;
+      rec.tick = m_nextTick++;
+      rec.now = tickTime;
+      rec.snapshot = m_claimed;
+      return true;
+    }
+
+    rec.type = REC_RECEPTION;
+    rec.rx = m_pending;
+    m_pendingValid = false;
+    if (rec.rx.senderId < m_claimed.size()) {
+      m_claimed[rec.rx.senderId].pos = Vector(rec.rx.posX, rec.rx.posY, 0);
+      m_claimed[rec.rx.senderId].vel = Vector(rec.rx.velX, rec.rx.velY, 0);
+    }
+    return true;
+  }
+
+private:
+  // Current format: rxTime,receiverId,msgType,senderId,posX,posY,velX,velY,txTime,rssi
+  // Older logs have no header and no rxTime column; the BSM timestamp is used.
+  bool ReadReception(BsmReception& rx)
+  {
+    std::string line;
+    while (std::getline(m_in, line)) {
+      if (line.empty()) continue;
+      if (line.compare(0, 6, "rxTime") == 0) {
+        m_hasRxTime = true;
+        continue;
+      }
+
+      const char* p = line.c_str();
+      char* end;
+      double rxTime = 0;
+      if (m_hasRxTime) {
+        rxTime = std::strtod(p, &end);
+        p = end + 1;
+      }
+      rx.receiverId = std::strtoul(p, &end, 10);
+      if (*end != ',') continue;
+
+      // The BSM runs up to the last column (rssi)
+      std::string rest(end + 1);
+      size_t last = rest.rfind(',');
+      if (last == std::string::npos || !ParseBsm(rest.substr(0, last), rx)) continue;
+      rx.rssi = std::strtod(rest.c_str() + last + 1, nullptr);
+      rx.rxTime = Seconds(m_hasRxTime ? rxTime : rx.txTime);
+      rx.size = last;
+      return true;
+    }
+    return false;
+  }
+
+  std::ifstream m_in;
+  bool m_hasRxTime = false;
+  std::vector<NodeSnapshot> m_claimed;
+  BsmReception m_pending;
+  bool m_pendingValid = false;
+  uint64_t m_nextTick = 0;
+};
+
+int RunReplay(const std::string& file)
+{
+  std::unique_ptr<ReplaySource> source;
+  auto binary = std::make_unique<BinaryReplaySource>(file);
+  uint32_t numVehicles = 0;
+  if (binary->Open(numVehicles)) {
+    g_numVehicles = numVehicles;
+    source = std::move(binary);
+  } else {
+    source = std::make_unique<RssiCsvReplaySource>(file, g_numVehicles);
+  }
+
+  nodeState.assign(g_numVehicles, NodeDetectorState());
+  tickSnapshot.assign(g_numVehicles, NodeSnapshot());
+  if (!g_labelFile.empty()) {
+    LoadAttackLabels(g_labelFile);
+  }
+  sweepPool.Start(g_detectorThreads);
+
+  auto wallStart = std::chrono::steady_clock::now();
+  uint64_t receptions = 0, ticks = 0;
+  ReplayRecord rec;
+  while (source->Next(rec)) {
+    if (rec.type == REC_RECEPTION) {
+      OnBsmReception(rec.rx);
+      receptions++;
+    } else {
+      if (!rec.snapshot.empty()) {
+        tickSnapshot.swap(rec.snapshot);
+        tickSnapshot.resize(g_numVehicles);
+      }
+      DetectionTick(rec.tick, rec.now, g_numVehicles);
+      ticks++;
+    }
+  }
+
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  std::cout << "REPLAY receptions=" << receptions
+            << " ticks=" << ticks
+            << " wallSeconds=" << wall
+            << " recordsPerSecond=" << (wall > 0 ? (receptions + ticks) / wall : 0.0)
+            << std::endl;
+
+  sweepPool.Stop();
+  if (g_evaluate) {
+    WriteRocTables();
+  }
+  return 0;
+}
+
+// -------------------------
+// Benchmark Counters
+// -------------------------
+// Printed as a single line so run_benchmarks.sh can parse it.
+void PrintBenchmarkSummary(std::chrono::steady_clock::time_point wallStart)
+{
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::cout << "BENCHMARK"
+            << " events=" << Simulator::GetEventCount()
+            << " wallSeconds=" << wall
+            << " simSeconds=" << Simulator::Now().GetSeconds()
+            << " peakRssKb=" << usage.ru_maxrss
+            << std::endl;
+}
+
+// -------------------------
+// Network Stack
+// -------------------------
+// 802.11p devices on every vehicle (not used with --abstractChannel), plus
+// IPv4 and UDP unless BSMs go over the raw link layer (--wsmp)
+void InstallWifi(NodeContainer vehicles)
+{
+  Ptr<PropagationLossModel> loss = CreateLossModel();
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel>();
+
+  CullingWifiPhyHelper phy;
+  if (g_rangeCulling) {
+    Ptr<RangeCulledWifiChannel> culled = CreateObject<RangeCulledWifiChannel>();
+    culled->SetModels(loss, delay);
+    phy.EnableRangeCulling();
+    phy.SetChannel(culled);
+  } else {
+    Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel>();
+    channel->SetPropagationLossModel(loss);
+    channel->SetPropagationDelayModel(delay);
+    phy.SetChannel(channel);
+  }
+  phy.Set("TxPowerStart", DoubleValue(20));
+  phy.Set("TxPowerEnd", DoubleValue(20));
+
+  WifiHelper wifi;
+  wifi.SetStandard(WIFI_STANDARD_80211p);
+  wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                               "DataMode", StringValue("OfdmRate6MbpsBW10MHz"),
+                               "ControlMode", StringValue("OfdmRate6MbpsBW10MHz"));
+
+  WifiMacHelper mac;
+  mac.SetType("ns3::AdhocWifiMac");
+
+  NetDeviceContainer devs = wifi.Install(phy, mac, vehicles);
+  if (g_wsmp) {
+    return;
+  }
+
+  InternetStackHelper inet;
+  inet.Install(vehicles);
+
+  Ipv4AddressHelper ip;
+  ip.SetBase("10.1.0.0", "255.255.0.0");  // Using same as original
+  ip.Assign(devs);
+}
+
 // =====================================================
 // MAIN
 // =====================================================
@@ -538,6 +2455,7 @@ int main(int argc, char *argv[])
   CommandLine cmd;
   cmd.AddValue("numVehicles", "Number of vehicles", g_numVehicles);
   cmd.AddValue("simTime", "Simulation time (s)", g_simTime);
+  cmd.AddValue("benchmark", "Print simulator performance counters at exit", g_benchmark);
   cmd.AddValue("enable_ddos", "Enable DDoS attack", g_enable_ddos);
   cmd.AddValue("enable_sybil", "Enable Sybil attack", g_enable_sybil);
   cmd.AddValue("enable_replay", "Enable Replay attack", g_enable_replay);
@@ -547,76 +2465,128 @@ int main(int argc, char *argv[])
   cmd.AddValue("enable_ml", "Enable ML-based mitigation", g_enable_ml);
   cmd.AddValue("enable_hybrid", "Enable Hybrid mitigation", g_enable_hybrid);
   cmd.AddValue("enable_rule", "Enable Rule-based mitigation", g_enable_rule);
+  cmd.AddValue("mobilityFile", "ns-2 mobility trace exported from SUMO", g_mobilityFile);
+  cmd.AddValue("commRange", "Communication range (m)", g_commRange);
+  cmd.AddValue("lossModel", "Propagation loss model TypeId (e.g. ns3::TwoRayGroundPropagationLossModel)", g_lossModel);
+  cmd.AddValue("tabulateLoss", "Interpolate the loss model from a precomputed distance table", g_tabulateLoss);
+  cmd.AddValue("lossTableRange", "Distance covered by the loss table (m)", g_lossTableRange);
+  cmd.AddValue("lossTableStep", "Resolution of the loss table (m)", g_lossTableStep);
+  cmd.AddValue("fadingM", "Nakagami m of the tabulated model's fading (0 = none)", g_fadingM);
+  cmd.AddValue("maxFadingGain", "Clamp of the fading gain (dB)", g_maxFadingGain);
+  cmd.AddValue("abstractChannel", "Deliver BSMs directly within commRange instead of simulating 802.11p", g_abstractChannel);
+  cmd.AddValue("abstractReliableRange", "Abstract channel: distance of certain reception (m)", g_abstractReliableRange);
+  cmd.AddValue("abstractCollisions", "Abstract channel: drop frames overlapping at a receiver", g_abstractCollisions);
+  cmd.AddValue("wsmp", "Send BSMs as raw 802.11 frames (EtherType 0x88DC) without the Internet stack", g_wsmp);
+  cmd.AddValue("beaconWheel", "Dispatch all beacons from one slotted timer with random phases and jitter", g_beaconWheel);
+  cmd.AddValue("beaconSlot", "Beacon wheel slot width (s)", g_beaconSlot);
+  cmd.AddValue("beaconJitter", "Maximum per-beacon jitter with the beacon wheel (s)", g_beaconJitter);
+  cmd.AddValue("rangeCulling", "Skip receivers the channel cannot reach (same results, fewer events)", g_rangeCulling);
+  cmd.AddValue("distributed", "Run under the distributed (MPI) simulator", g_distributed);
+  cmd.AddValue("detectorThreads", "Worker threads for the per-node detector sweeps", g_detectorThreads);
+  cmd.AddValue("rssiLog", "Log every BSM reception to rssi_log.csv", g_logRssi);
+  cmd.AddValue("recordFile", "Record the detector inputs to this binary file", g_recordFile);
+  cmd.AddValue("replayFile", "Replay recorded detector inputs (binary or rssi_log.csv) instead of simulating", g_replayFile);
+  cmd.AddValue("evaluate", "Write ROC/PR tables for all detectors to roc_log.csv", g_evaluate);
+  cmd.AddValue("trustThresholds", "Trust score thresholds to evaluate (flag below)", g_thresholds[DET_TRUST]);
+  cmd.AddValue("mlThresholds", "Speed thresholds to evaluate (flag above)", g_thresholds[DET_ML]);
+  cmd.AddValue("ruleThresholds", "Packets per 0.5 s thresholds to evaluate (flag above)", g_thresholds[DET_RULE]);
+  cmd.AddValue("hybridThresholds", "Hybrid trust thresholds to evaluate (flag below)", g_thresholds[DET_HYBRID]);
+  cmd.AddValue("labelFile", "attack_log.csv of the recorded run, labels a replay for --evaluate", g_labelFile);
+  cmd.AddValue("branches", "Fork into these variants at branchTime (name:flag=0|1,...;name:...)", g_branches);
+  cmd.AddValue("branchTime", "Simulation time of the fork in branch mode (s)", g_branchTime);
   cmd.Parse(argc, argv);
+  SetupDetectorRoc();
+
+  if (!g_branches.empty()) {
+    if (g_distributed) {
+      NS_FATAL_ERROR("Branch mode cannot be combined with distributed mode");
+    }
+    ParseBranches(g_branches);
+    HoldBackAttacks();
+  }
+  if (g_abstractChannel && g_distributed) {
+    NS_FATAL_ERROR("The abstract channel cannot be combined with distributed mode");
+  }
+
+  if (g_distributed) {
+#ifdef NS3_MPI
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+    MpiInterface::Enable(&argc, &argv);
+    g_rank = MpiInterface::GetSystemId();
+    g_numRanks = MpiInterface::GetSize();
+#else
+    NS_FATAL_ERROR("Distributed mode requires ns-3 configured with --enable-mpi");
+#endif
+  }
 
   // Output files
-  bsm_output.open("bsm_log.csv");
+  bsm_output.open(LogFileName("bsm_log.csv"));
   bsm_output << "nodeId,posX,posY,velX,velY,timestamp" << "\n";
   
-  attack_output.open("attack_log.csv");
-  attack_output << "timestamp,attackerId,attackType,details" << "\n";
+  attack_output.open(LogFileName("attack_log.csv"));
+  attack_output << "id,attackerId,attackType,start,end" << "\n";
   
-  mitigation_output.open("mitigation_log.csv");
+  mitigation_output.open(LogFileName("mitigation_log.csv"));
   mitigation_output << "timestamp,nodeId,mitigationType,details" << "\n";
   
-  trust_output.open("trust_log.csv");
+  trust_output.open(LogFileName("trust_log.csv"));
   trust_output << "timestamp,nodeId,trustScore,lowTrustFlag" << "\n";
   
-  ml_output.open("ml_detection_log.csv");
+  ml_output.open(LogFileName("ml_detection_log.csv"));
   ml_output << "timestamp,nodeId,eventType,suspiciousCount" << "\n";
   
-  neighbor_output.open("neighbor_log.csv");
+  neighbor_output.open(LogFileName("neighbor_log.csv"));
   neighbor_output << "timestamp,nodeId,neighborCount" << "\n";
   
-  jammer_output.open("jammer_log.csv");
+  jammer_output.open(LogFileName("jammer_log.csv"));
   jammer_output << "timestamp,jammerId,eventType" << "\n";
   
-  sybil_output.open("sybil_log.csv");
+  sybil_output.open(LogFileName("sybil_log.csv"));
   sybil_output << "timestamp,fakeId,attackerId,posX,posY" << "\n";
   
-  ddos_output.open("ddos_log.csv");
+  ddos_output.open(LogFileName("ddos_log.csv"));
   ddos_output << "timestamp,attackerId,attackType,detail" << "\n";
   
-  msg_falsification_output.open("msg_falsification_log.csv");
+  msg_falsification_output.open(LogFileName("msg_falsification_log.csv"));
   msg_falsification_output << "timestamp,attackerId,fakePosX,fakePosY" << "\n";
 
-  NodeContainer vehicles;
-  vehicles.Create(g_numVehicles);
-
-  // Load SUMO mobility (using the same file as before)
-  std::string mobilityFile = "/home/jeanhuit/Documents/Workspace/simulation/roads-sumo/2025-12-05-21-50-47/mobility.tcl";
-  Ns2MobilityHelper ns2(mobilityFile);
-  ns2.Install(vehicles.Begin(), vehicles.End());
+  if (!g_replayFile.empty()) {
+    return RunReplay(g_replayFile);
+  }
 
-  // ----------------------------------------------------
-  // WiFi 802.11p
-  // ----------------------------------------------------
-  YansWifiChannelHelper channel;
-  channel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-  channel.AddPropagationLoss("ns3::FriisPropagationLossModel");
+  if (g_logRssi) {
+    rssi_output.open(LogFileName("rssi_log.csv"));
+    rssi_output << "rxTime,receiverId,msgType,senderId,posX,posY,velX,velY,txTime,rssi" << "\n";
+  }
 
-  YansWifiPhyHelper phy;
-  phy.SetChannel(channel.Create());
-  phy.Set("TxPowerStart", DoubleValue(20));
-  phy.Set("TxPowerEnd", DoubleValue(20));
+  if (!g_recordFile.empty()) {
+    record_output.open(LogFileName(g_recordFile), std::ios::binary);
+    RecordHeader(g_numVehicles);
+  }
 
-  WifiHelper wifi;
-  wifi.SetStandard(WIFI_STANDARD_80211p);
-  wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
-                               "DataMode", StringValue("OfdmRate6MbpsBW10MHz"),
-                               "ControlMode", StringValue("OfdmRate6MbpsBW10MHz"));
+  nodeState.assign(g_numVehicles, NodeDetectorState());
+  sweepPool.Start(g_detectorThreads);
 
-  WifiMacHelper mac;
-  mac.SetType("ns3::AdhocWifiMac");
+  // Assign every vehicle to the rank owning its starting region
+  nodeRank.assign(g_numVehicles, 0);
+  if (g_numRanks > 1) {
+    PartitionByRegion(ReadInitialPositions(g_mobilityFile, g_numVehicles), g_numRanks);
+  }
 
-  NetDeviceContainer devs = wifi.Install(phy, mac, vehicles);
+  NodeContainer vehicles;
+  for (uint32_t i = 0; i < g_numVehicles; i++) {
+    vehicles.Add(CreateObject<Node>(nodeRank[i]));
+  }
 
-  InternetStackHelper inet;
-  inet.Install(vehicles);
+  // Load SUMO mobility (using the same file as before)
+  Ns2MobilityHelper ns2(g_mobilityFile);
+  ns2.Install(vehicles.Begin(), vehicles.End());
 
-  Ipv4AddressHelper ip;
-  ip.SetBase("10.1.0.0", "255.255.0.0");  // Using same as original
-  ip.Assign(devs);
+  if (g_abstractChannel) {
+    abstractChannel.Install(vehicles);
+  } else {
+    InstallWifi(vehicles);
+  }
 
   // Enhanced BSM apps + RSSI receiver
   for (uint32_t i = 0; i < vehicles.GetN(); i++)
@@ -624,33 +2594,38 @@ int main(int argc, char *argv[])
     Ptr<Node> node = vehicles.Get(i);
 
     // Create receiving socket
-    Ptr<Socket> recvSock = Socket::CreateSocket(node, UdpSocketFactory::GetTypeId());
-    recvSock->Bind(InetSocketAddress(Ipv4Address::GetAny(), 5000));
-    recvSock->SetRecvCallback(MakeCallback(&ReceivePacket));
+    if (g_wsmp) {
+      node->RegisterProtocolHandler(MakeCallback(&ReceiveWsmp), g_bsmEtherType, node->GetDevice(0));
+    } else if (!g_abstractChannel) {
+      Ptr<Socket> recvSock = Socket::CreateSocket(node, UdpSocketFactory::GetTypeId());
+      recvSock->Bind(InetSocketAddress(Ipv4Address::GetAny(), 5000));
+      recvSock->SetRecvCallback(MakeCallback(&ReceivePacket));
+    }
+
+    // Apps and attacks only run on the rank that owns the vehicle
+    if (!IsLocalNode(i)) continue;
+
+#ifdef NS3_MPI
+    if (g_numRanks > 1) {
+      Ptr<MpiReceiver> mpiRec = CreateObject<MpiReceiver>();
+      mpiRec->SetReceiveCallback(MakeBoundCallback(&ReceiveForwardedBsm, node));
+      node->GetDevice(0)->AggregateObject(mpiRec);
+    }
+#endif
 
     // Create sending socket
-    Ptr<Socket> sendSock = Socket::CreateSocket(node, UdpSocketFactory::GetTypeId());
-    sendSock->SetAllowBroadcast(true);
-    sendSock->Connect(InetSocketAddress(Ipv4Address("255.255.255.255"), 5000));
-
-    // Determine if this node is an attacker and what type
-    std::string attackType = "none";
-    bool isAttacker = false;
-    
-    if (g_enable_ddos && i == 5) {
-      attackType = "ddos";
-      isAttacker = true;
-    } else if (g_enable_sybil && i == 10) {
-      attackType = "sybil";
-      isAttacker = true;
-    } else if (g_enable_replay && i == 15) {
-      attackType = "replay";
-      isAttacker = true;
-    } else if (g_enable_msg_falsification && i == 20) {
-      attackType = "falsification";
-      isAttacker = true;
+    Ptr<Socket> sendSock;
+    if (!g_abstractChannel && !g_wsmp) {
+      sendSock = Socket::CreateSocket(node, UdpSocketFactory::GetTypeId());
+      sendSock->SetAllowBroadcast(true);
+      sendSock->Connect(InetSocketAddress(Ipv4Address("255.255.255.255"), 5000));
     }
 
+    // Determine if this node is an attacker and what type (the jammer
+    // sends regular BSMs next to its jamming socket)
+    std::string attackType = AttackerRole(i);
+    bool isAttacker = attackType != "none" && attackType != "jamming";
+
     // Create enhanced BSM app
     Ptr<EnhancedBsmApp> app = CreateObject<EnhancedBsmApp>();
     app->Setup(sendSock, node, g_bsmInterval, attackType, isAttacker);
@@ -658,49 +2633,46 @@ int main(int argc, char *argv[])
     app->SetStartTime(Seconds(1.0));
   }
 
-  // Start attack injection (after simulation starts)
-  if (g_enable_ddos) {
-    Simulator::Schedule(Seconds(3.0), &InjectDdosAttack, vehicles, 5);
-  }
-  if (g_enable_sybil) {
-    Simulator::Schedule(Seconds(4.0), &InjectSybilAttack, vehicles, 10);
-  }
-  if (g_enable_replay) {
-    Simulator::Schedule(Seconds(6.0), &InjectReplayAttack, vehicles, 15);
-  }
-  if (g_enable_msg_falsification) {
-    Simulator::Schedule(Seconds(8.0), &InjectMsgFalsification, vehicles, 20);
-  }
-
-  // Jammer node = node 25
-  if (g_enable_jamming) {
-    Ptr<Node> jnode = vehicles.Get(25);
-    Ptr<Socket> jsock = Socket::CreateSocket(jnode, UdpSocketFactory::GetTypeId());
-    jsock->SetAllowBroadcast(true);
-    jsock->Connect(InetSocketAddress(Ipv4Address("255.255.255.255"), 5001));
-    Simulator::Schedule(Seconds(2.0), &InjectJammerNode, jsock, 25);
+  ScheduleAttacks(vehicles);
+  if (!branches.empty()) {
+    Simulator::Schedule(Seconds(g_branchTime), &ForkBranches, vehicles);
   }
 
-  // Start mitigation systems
-  if (g_enable_trust) {
-    Simulator::Schedule(Seconds(1.0), &UpdateTrustScores, vehicles);
-  }
-  if (g_enable_ml) {
-    Simulator::Schedule(Seconds(1.0), &RunMLDetection, vehicles);
-  }
-  if (g_enable_rule) {
-    Simulator::Schedule(Seconds(0.5), &UpdateRuleBasedDetection, vehicles);
-  }
-  if (g_enable_hybrid) {
-    Simulator::Schedule(Seconds(1.5), &RunHybridDetection, vehicles);
+  // Start mitigation systems (one detection tick drives all detectors;
+  // branches may enable detectors the prefix runs without)
+  if (g_enable_trust || g_enable_ml || g_enable_rule || g_enable_hybrid || !branches.empty()) {
+    Simulator::Schedule(Seconds(0.0), &RunDetectionTick, vehicles, 0);
   }
 
   // Start neighbor logging
   Simulator::Schedule(Seconds(1.0), &LogNeighbors, vehicles);
 
+#ifdef NS3_MPI
+  if (g_numRanks > 1) {
+    // No point-to-point links cross ranks, so the only bound on the
+    // synchronization window is the cross-region reception delay.
+    Ptr<DistributedSimulatorImpl> dist =
+        DynamicCast<DistributedSimulatorImpl>(Simulator::GetImplementation());
+    dist->BoundLookAhead(CrossRankLookahead());
+  }
+#endif
+
   Simulator::Stop(Seconds(g_simTime));
+  auto wallStart = std::chrono::steady_clock::now();
   Simulator::Run();
+  if (!branchPids.empty()) {
+    Simulator::Destroy();
+    return WaitForBranches();
+  }
+  EndAllAttackLabels();
+  if (g_benchmark) {
+    PrintBenchmarkSummary(wallStart);
+  }
   Simulator::Destroy();
+  sweepPool.Stop();
+  if (g_evaluate) {
+    WriteRocTables();
+  }
 
   // Close output files properly
   bsm_output.close();
@@ -713,6 +2685,14 @@ int main(int argc, char *argv[])
   sybil_output.close();
   ddos_output.close();
   msg_falsification_output.close();
+  rssi_output.close();
+  record_output.close();
+
+#ifdef NS3_MPI
+  if (g_distributed) {
+    MpiInterface::Disable();
+  }
+#endif
 
   return 0;
 }
\ No newline at end of file